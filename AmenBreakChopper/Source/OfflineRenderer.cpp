@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+    Part of AmenBreakChopper
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include "PluginProcessor.h"
+
+//==============================================================================
+OfflineRenderer::FixedTempoPlayHead::FixedTempoPlayHead(double bpm,
+                                                        double sampleRate)
+    : mBpm(bpm), mSampleRate(sampleRate) {}
+
+void OfflineRenderer::FixedTempoPlayHead::setTimeInSamples(
+    juce::int64 timeInSamples) {
+  mTimeInSamples = timeInSamples;
+}
+
+double
+OfflineRenderer::FixedTempoPlayHead::getPpqAt(juce::int64 timeInSamples) const {
+  return static_cast<double>(timeInSamples) / mSampleRate * mBpm / 60.0;
+}
+
+juce::Optional<juce::AudioPlayHead::PositionInfo>
+OfflineRenderer::FixedTempoPlayHead::getPosition() const {
+  PositionInfo info;
+  info.setBpm(mBpm);
+  info.setTimeInSamples(mTimeInSamples);
+  info.setTimeInSeconds(static_cast<double>(mTimeInSamples) / mSampleRate);
+  info.setPpqPosition(getPpqAt(mTimeInSamples));
+  info.setTimeSignature(juce::AudioPlayHead::TimeSignature{});
+  info.setIsPlaying(true);
+  return info;
+}
+
+//==============================================================================
+bool OfflineRenderer::isRenderCommandLine(const juce::StringArray &args) {
+  return args.contains("--render");
+}
+
+juce::String OfflineRenderer::parseCommandLine(const juce::StringArray &args,
+                                               Options &options) {
+  auto getValue = [&args](const juce::String &name) -> juce::String {
+    const int index = args.indexOf(name);
+    return (index >= 0 && index + 1 < args.size()) ? args[index + 1]
+                                                   : juce::String();
+  };
+  auto getFile = [&getValue](const juce::String &name) {
+    const auto path = getValue(name);
+    return path.isEmpty() ? juce::File()
+                          : juce::File::getCurrentWorkingDirectory()
+                                .getChildFile(path.unquoted());
+  };
+
+  options.inputFile = getFile("--input");
+  options.midiFile = getFile("--midi");
+  options.outputFile = getFile("--output");
+  options.midiOutputFile = getFile("--midi-output");
+
+  if (options.inputFile == juce::File() || options.midiFile == juce::File() ||
+      options.outputFile == juce::File())
+    return "Usage: --render --input <wav> --midi <mid> --bpm <bpm> "
+           "--output <wav> [--midi-output <mid>] [--block-size <samples>]";
+
+  const auto bpm = getValue("--bpm");
+  if (bpm.isNotEmpty())
+    options.bpm = bpm.getDoubleValue();
+  if (options.bpm < 20.0 || options.bpm > 999.0)
+    return "Invalid --bpm: " + bpm;
+
+  const auto blockSize = getValue("--block-size");
+  if (blockSize.isNotEmpty())
+    options.blockSize = blockSize.getIntValue();
+  if (options.blockSize < 16 || options.blockSize > 8192)
+    return "Invalid --block-size: " + blockSize;
+
+  return {};
+}
+
+//==============================================================================
+juce::String OfflineRenderer::render(const Options &options) {
+  juce::AudioFormatManager formatManager;
+  formatManager.registerBasicFormats();
+
+  std::unique_ptr<juce::AudioFormatReader> reader(
+      formatManager.createReaderFor(options.inputFile));
+  if (reader == nullptr)
+    return "Cannot read audio file: " + options.inputFile.getFullPathName();
+
+  const double sampleRate = reader->sampleRate;
+  const int numSamples = static_cast<int>(reader->lengthInSamples);
+
+  juce::AudioBuffer<float> input(2, numSamples);
+  reader->read(&input, 0, numSamples, 0, true, true);
+  if (reader->numChannels == 1)
+    input.copyFrom(1, 0, input, 0, 0, numSamples); // Mono to both sides
+
+  juce::MidiMessageSequence midiInput;
+  auto error = loadMidi(options.midiFile, options.bpm, sampleRate, midiInput);
+  if (error.isNotEmpty())
+    return error;
+
+  // --- Processor setup ---
+  AmenBreakChopperAudioProcessor processor;
+  FixedTempoPlayHead playHead(options.bpm, sampleRate);
+  processor.setPlayHead(&playHead);
+  processor.setNonRealtime(true);
+  processor.setPlayConfigDetails(2, 2, sampleRate, options.blockSize);
+  processor.setHeadless(true);
+  configureForHeadless(processor);
+  processor.prepareToPlay(sampleRate, options.blockSize);
+
+  // --- Render ---
+  juce::AudioBuffer<float> output(2, numSamples);
+  juce::AudioBuffer<float> block(2, options.blockSize);
+  juce::MidiBuffer midi;
+  juce::MidiMessageSequence midiOutput;
+  int nextMidiEvent = 0;
+
+  for (int start = 0; start < numSamples; start += options.blockSize) {
+    const int blockLength = juce::jmin(options.blockSize, numSamples - start);
+    block.setSize(2, blockLength, false, false, true);
+    for (int channel = 0; channel < 2; ++channel)
+      block.copyFrom(channel, 0, input, channel, start, blockLength);
+
+    midi.clear();
+    for (; nextMidiEvent < midiInput.getNumEvents(); ++nextMidiEvent) {
+      const auto &message =
+          midiInput.getEventPointer(nextMidiEvent)->message;
+      const int time = static_cast<int>(message.getTimeStamp());
+      if (time >= start + blockLength)
+        break;
+      midi.addEvent(message, juce::jmax(0, time - start));
+    }
+
+    playHead.setTimeInSamples(start);
+    processor.processBlock(block, midi);
+
+    for (int channel = 0; channel < 2; ++channel)
+      output.copyFrom(channel, start, block, channel, 0, blockLength);
+
+    // Generated notes, timestamped in MIDI file ticks
+    for (const auto metadata : midi) {
+      auto message = metadata.getMessage();
+      message.setTimeStamp(playHead.getPpqAt(start + metadata.samplePosition) *
+                           kMidiTicksPerQuarter);
+      midiOutput.addEvent(message);
+    }
+  }
+
+  processor.releaseResources();
+  processor.setPlayHead(nullptr);
+
+  // --- Output ---
+  error = writeAudio(options.outputFile, output, sampleRate,
+                     juce::jlimit(16, 24, (int)reader->bitsPerSample));
+  if (error.isEmpty() && options.midiOutputFile != juce::File())
+    error = writeMidi(options.midiOutputFile, midiOutput);
+  return error;
+}
+
+void OfflineRenderer::configureForHeadless(
+    AmenBreakChopperAudioProcessor &processor) {
+  auto setParameter = [&processor](const char *parameterID, float value) {
+    if (auto *p = processor.getValueTreeState().getParameter(parameterID))
+      p->setValueNotifyingHost(p->convertTo0to1(value));
+  };
+  setParameter("inputEnabled", 1.0f);
+  setParameter("inputChanL", 1.0f);
+  setParameter("inputChanR", 2.0f);
+  setParameter("bpmSyncMode", 0.0f);
+}
+
+//==============================================================================
+juce::String OfflineRenderer::loadMidi(const juce::File &file, double bpm,
+                                       double sampleRate,
+                                       juce::MidiMessageSequence &sequence) {
+  juce::FileInputStream stream(file);
+  juce::MidiFile midiFile;
+  if (!stream.openedOk() || !midiFile.readFrom(stream))
+    return "Cannot read MIDI file: " + file.getFullPathName();
+
+  // Musical time is mapped onto the render BPM so the chop pattern lines up
+  // with the fake host grid; SMPTE files keep their absolute times.
+  const short timeFormat = midiFile.getTimeFormat();
+  if (timeFormat <= 0)
+    midiFile.convertTimestampTicksToSeconds();
+
+  for (int track = 0; track < midiFile.getNumTracks(); ++track) {
+    const auto *events = midiFile.getTrack(track);
+    for (int i = 0; i < events->getNumEvents(); ++i) {
+      auto message = events->getEventPointer(i)->message;
+      if (message.isMetaEvent())
+        continue;
+
+      const double seconds =
+          timeFormat > 0 ? message.getTimeStamp() / timeFormat * 60.0 / bpm
+                         : message.getTimeStamp();
+      message.setTimeStamp(std::round(seconds * sampleRate));
+      sequence.addEvent(message);
+    }
+  }
+  return {};
+}
+
+juce::String OfflineRenderer::writeAudio(const juce::File &file,
+                                         const juce::AudioBuffer<float> &audio,
+                                         double sampleRate, int bitsPerSample) {
+  file.deleteFile();
+  auto stream = std::make_unique<juce::FileOutputStream>(file);
+  if (!stream->openedOk())
+    return "Cannot write audio file: " + file.getFullPathName();
+
+  juce::WavAudioFormat wavFormat;
+  std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(
+      stream.get(), sampleRate, (unsigned int)audio.getNumChannels(),
+      bitsPerSample, {}, 0));
+  if (writer == nullptr)
+    return "Cannot create WAV writer for: " + file.getFullPathName();
+  stream.release(); // Owned by the writer now
+
+  if (!writer->writeFromAudioSampleBuffer(audio, 0, audio.getNumSamples()))
+    return "Failed writing audio file: " + file.getFullPathName();
+  return {};
+}
+
+juce::String
+OfflineRenderer::writeMidi(const juce::File &file,
+                           const juce::MidiMessageSequence &sequence) {
+  juce::MidiFile midiFile;
+  midiFile.setTicksPerQuarterNote(kMidiTicksPerQuarter);
+  midiFile.addTrack(sequence);
+
+  file.deleteFile();
+  juce::FileOutputStream stream(file);
+  if (!stream.openedOk() || !midiFile.writeTo(stream))
+    return "Cannot write MIDI file: " + file.getFullPathName();
+  return {};
+}
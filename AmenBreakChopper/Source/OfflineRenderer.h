@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+    Part of AmenBreakChopper
+
+    Headless render mode of the Standalone app. Drives
+    AmenBreakChopperAudioProcessor::processBlock faster than realtime from a
+    WAV file and a MIDI file of notes 0-15 / CCs, with a fake play head at a
+    fixed BPM, and writes the chopped audio and the generated MIDI.
+
+      ABC --render --input break.wav --midi chops.mid --bpm 174
+          --output chopped.wav [--midi-output notes.mid] [--block-size 512]
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+
+class AmenBreakChopperAudioProcessor;
+
+class OfflineRenderer {
+public:
+  struct Options {
+    juce::File inputFile;
+    juce::File midiFile;
+    juce::File outputFile;
+    juce::File midiOutputFile; // Optional
+    double bpm{120.0};
+    int blockSize{512};
+  };
+
+  static bool isRenderCommandLine(const juce::StringArray &args);
+
+  // Parses the --render arguments. Returns an error message, or an empty
+  // string on success.
+  static juce::String parseCommandLine(const juce::StringArray &args,
+                                       Options &options);
+
+  // Returns an error message, or an empty string on success.
+  static juce::String render(const Options &options);
+
+  // Records from inputs 1/2 and follows the host transport, whatever the
+  // Standalone defaults are.
+  static void configureForHeadless(AmenBreakChopperAudioProcessor &processor);
+
+  // Transport for the processor: always playing, at a fixed tempo, with the
+  // position advanced by the caller after every block.
+  class FixedTempoPlayHead : public juce::AudioPlayHead {
+  public:
+    FixedTempoPlayHead(double bpm, double sampleRate);
+
+    void setTimeInSamples(juce::int64 timeInSamples);
+    double getPpqAt(juce::int64 timeInSamples) const;
+
+    juce::Optional<PositionInfo> getPosition() const override;
+
+  private:
+    double mBpm;
+    double mSampleRate;
+    juce::int64 mTimeInSamples{0};
+  };
+
+private:
+  static juce::String loadMidi(const juce::File &file, double bpm,
+                               double sampleRate,
+                               juce::MidiMessageSequence &sequence);
+  static juce::String writeAudio(const juce::File &file,
+                                 const juce::AudioBuffer<float> &audio,
+                                 double sampleRate, int bitsPerSample);
+  static juce::String writeMidi(const juce::File &file,
+                                const juce::MidiMessageSequence &sequence);
+
+  static constexpr int kMidiTicksPerQuarter = 960;
+};
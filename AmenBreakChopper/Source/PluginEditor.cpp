@@ -421,28 +421,8 @@ AmenBreakChopperAudioProcessorEditor::AmenBreakChopperAudioProcessorEditor(
     }
   }
 
-  // --- UI Event Bridge ---
-  // Forward MIDI events from Processor to WebView (Thread-Safe)
-  audioProcessor.onNoteEvent = [this](int note1, int note2) {
-    juce::MessageManager::callAsync([this, note1, note2] {
-      // WebView might be null or deleted if editor is closing, but 'this' is
-      // captured safely? Editor owns WebView, so if 'this' is alive, WebView is
-      // alive. NoteEvent is bound to 'this', so we need to clear it in
-      // destructor to avoid dangling pointer callAsync? Actually, callAsync
-      // captures 'this'. If Editor is deleted, the lambda might still run? We
-      // should use SafePointer or WeakReference if strict, but
-      // Component::BailOutChecker is built-in for some things. For now, simple
-      // check:
-      if (isWebViewLoaded) {
-        juce::String js = "if (typeof window.juce_emitEvent === 'function') { "
-                          "window.juce_emitEvent('note', { note1: " +
-                          juce::String(note1) +
-                          ", note2: " + juce::String(note2) + " }); }";
-        webView.evaluateJavascript(js);
-      }
-    });
-  };
-
+  // Note events from the Processor are queued lock-free on the audio thread
+  // and forwarded to the WebView in batches from timerCallback.
   startTimerHz(30); // Start 30Hz polling for waveform updates
 }
 
@@ -455,6 +435,21 @@ void AmenBreakChopperAudioProcessorEditor::paint(juce::Graphics &g) {
 }
 
 void AmenBreakChopperAudioProcessorEditor::timerCallback() {
+  // Drain note/tick events queued by the audio thread since the last frame
+  // into a single script call.
+  juce::String noteEventsJs;
+  AmenBreakChopperAudioProcessor::NoteEvent noteEvent;
+  while (audioProcessor.popNoteEvent(noteEvent)) {
+    noteEventsJs << "window.juce_emitEvent('note', { note1: " << noteEvent.note1
+                 << ", note2: " << noteEvent.note2 << " });";
+  }
+
+  if (isWebViewLoaded && noteEventsJs.isNotEmpty()) {
+    webView.evaluateJavascript(
+        "if (typeof window.juce_emitEvent === 'function') { " + noteEventsJs +
+        " }");
+  }
+
   if (!isWebViewLoaded) {
     if (isShowing() && getWidth() > 0 && getHeight() > 0) {
       if (framesWaited++ > 5) {
@@ -499,28 +494,23 @@ void AmenBreakChopperAudioProcessorEditor::timerCallback() {
   }
 
   if (audioProcessor.mWaveformDirty.exchange(false)) {
-      std::vector<float> waveform = audioProcessor.getWaveformData();
-      int currentSeqPos = audioProcessor.getSequencePosition(); // Use public getter
-      
-      // Manually construct JSON string for speed/simplicity or use JUCE JSON
-      // We need to send an array of 512 floats.
-      juce::DynamicObject* obj = new juce::DynamicObject();
-      juce::Array<juce::var> dataArray;
-      dataArray.ensureStorageAllocated(static_cast<int>(waveform.size()));
-      
-      for (float sample : waveform) {
-          dataArray.add(sample);
-      }
-      
-      obj->setProperty("data", dataArray);
-      obj->setProperty("currentSeqPos", currentSeqPos); // Send synchronised position
-      
+    int currentSeqPos = 0;
+    if (!audioProcessor.getWaveformFrame(waveformFrame, currentSeqPos)) {
+      audioProcessor.mWaveformDirty = true; // Retry on the next tick
+    } else {
+      // The frame travels as base64 of the raw int8 min/max pairs; the UI
+      // decodes it with typed arrays instead of parsing 512 JSON numbers.
       juce::String js = "if (typeof window.juce_emitEvent === 'function') { "
-                        "window.juce_emitEvent('waveform', " + juce::JSON::toString(juce::var(obj)) + "); }";
-      
+                        "window.juce_emitEvent('waveform', {frame: '" +
+                        juce::Base64::toBase64(waveformFrame.data(),
+                                               waveformFrame.size()) +
+                        "', currentSeqPos: " + juce::String(currentSeqPos) +
+                        "}); }";
+
       if (isWebViewLoaded) {
           webView.evaluateJavascript(js);
       }
+    }
   }
 }
 
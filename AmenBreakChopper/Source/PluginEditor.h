@@ -35,6 +35,9 @@ private:
   // Cache to track parameter changes
   std::map<juce::String, float> lastParameterValues;
 
+  // Reused for every waveform update
+  AmenBreakChopperAudioProcessor::WaveformFrame waveformFrame;
+
   // Helper to send events to JS
   void sendParameterUpdate(const juce::String &paramId, float newValue);
 
@@ -16,10 +16,15 @@ AmenBreakChopperAudioProcessor::AmenBreakChopperAudioProcessor()
               .withInput("Input", juce::AudioChannelSet::stereo(), true)
               .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
       mValueTreeState(*this, nullptr, "PARAMETERS", createParameterLayout()) {
+  cacheParameters();
   mValueTreeState.state.setProperty("oscHostAddress", "127.0.0.1", nullptr);
   mReceiver.addListener(this);
   mValueTreeState.addParameterListener("oscSendPort", this);
   mValueTreeState.addParameterListener("oscReceivePort", this);
+  mValueTreeState.addParameterListener("oscTransport", this);
+  mValueTreeState.addParameterListener("delayTime", this);
+  mValueTreeState.addParameterListener("delayAdjust", this);
+  mValueTreeState.addParameterListener("minTempo", this);
 
   // --- Defaults for Standalone ---
   if (juce::JUCEApplicationBase::isStandaloneApp()) {
@@ -27,20 +32,94 @@ AmenBreakChopperAudioProcessor::AmenBreakChopperAudioProcessor()
       if (auto* p = mValueTreeState.getParameter("inputEnabled"))
           p->setValueNotifyingHost(0.0f);
   }
+
+  startTimerHz(kParameterPublishHz);
+}
+
+void AmenBreakChopperAudioProcessor::cacheParameters() {
+  auto raw = [this](const char *parameterID) {
+    auto *value = mValueTreeState.getRawParameterValue(parameterID);
+    jassert(value != nullptr);
+    return value;
+  };
+  auto param = [this](const char *parameterID) {
+    auto *parameter = mValueTreeState.getParameter(parameterID);
+    jassert(parameter != nullptr);
+    return parameter;
+  };
+
+  mParams.bpmSyncMode = raw("bpmSyncMode");
+  mParams.inputEnabled = raw("inputEnabled");
+  mParams.inputChanL = raw("inputChanL");
+  mParams.inputChanR = raw("inputChanR");
+  mParams.delayTimeValue = raw("delayTime");
+  mParams.midiInputChannel = raw("midiInputChannel");
+  mParams.midiOutputChannel = raw("midiOutputChannel");
+  mParams.midiCcSeqReset = raw("midiCcSeqReset");
+  mParams.midiCcSeqResetMode = raw("midiCcSeqResetMode");
+  mParams.midiCcHardReset = raw("midiCcHardReset");
+  mParams.midiCcHardResetMode = raw("midiCcHardResetMode");
+  mParams.midiCcSoftReset = raw("midiCcSoftReset");
+  mParams.midiCcSoftResetMode = raw("midiCcSoftResetMode");
+  mParams.midiCcDelayAdjustFwd = raw("midiCcDelayAdjustFwd");
+  mParams.midiCcDelayAdjustBwd = raw("midiCcDelayAdjustBwd");
+  mParams.chopFadeMs = raw("chopFadeMs");
+  mParams.delayInterpolation = raw("delayInterpolation");
+  mParams.oscBundling = raw("oscBundling");
+  mParams.oscTimeTags = raw("oscTimeTags");
+  mParams.midiClockBandwidth = raw("midiClockBandwidth");
+  mParams.minTempo = raw("minTempo");
+  mParams.voiceCount = raw("voiceCount");
+  mParams.voiceLength = raw("voiceLength");
+  mParams.voiceLevel = raw("voiceLevel");
+
+  mParams.delayTime = param("delayTime");
+  mParams.sequencePosition = param("sequencePosition");
+  mParams.noteSequencePosition = param("noteSequencePosition");
+  mParams.delayAdjust =
+      static_cast<juce::AudioParameterInt *>(param("delayAdjust"));
+  mParams.delayAdjustCcStep =
+      static_cast<juce::AudioParameterInt *>(param("delayAdjustCcStep"));
+}
+
+AmenBreakChopperAudioProcessor::~AmenBreakChopperAudioProcessor() {
+  stopTimer();
+  mReceiver.disconnect(); // Stops the thread that calls oscMessageReceived
 }
 
-AmenBreakChopperAudioProcessor::~AmenBreakChopperAudioProcessor() {}
+bool AmenBreakChopperAudioProcessor::getWaveformFrame(WaveformFrame &frame,
+                                                      int &sequencePosition) {
+  // Keeps prepareToPlay/releaseResources from resizing the summary under us
+  const CheckedCriticalSection::ScopedLockType sl(mWaveformLock);
+
+  for (int attempt = 0; attempt < kMaxWaveformSnapshotAttempts; ++attempt) {
+    const auto sequence = mWaveformSequence.load(std::memory_order_acquire);
+    if ((sequence & 1) == 0) {
+      const auto timing = mWaveformTiming;
+      fillWaveformFrame(frame, timing);
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      // No block was published while we read, so the frame is consistent
+      if (mWaveformSequence.load(std::memory_order_relaxed) == sequence) {
+        sequencePosition = timing.sequencePosition;
+        return true;
+      }
+    }
+    juce::Thread::yield();
+  }
+  return false;
+}
 
-std::vector<float> AmenBreakChopperAudioProcessor::getWaveformData() {
-  std::vector<float> waveformData;
-  waveformData.reserve(16 * 32);
+void AmenBreakChopperAudioProcessor::fillWaveformFrame(
+    WaveformFrame &frame, const WaveformTiming &timing) const {
+  frame.fill(0);
 
   // 1. Calculate timing
   // Use stored bpm from processBlock
-  double bpm = mCurrentBpm.load();
+  double bpm = timing.bpm;
   if (bpm <= 0.1) bpm = 120.0;
   
-  double sampleRate = mSampleRate;
+  double sampleRate = timing.sampleRate;
   if (sampleRate <= 0.0) sampleRate = 44100.0;
 
   double eighthNoteSamples = (60.0 / bpm) / 2.0 * sampleRate;
@@ -51,16 +130,13 @@ std::vector<float> AmenBreakChopperAudioProcessor::getWaveformData() {
   // Step 15 ends at mWritePosition.
   // Step 0 starts at mWritePosition - 16 * eighthNoteSamples.
   
-  int bufferSize = mDelayBuffer.getNumSamples();
-  if (bufferSize == 0) return std::vector<float>(16 * 32, 0.0f);
+  int bufferSize = mDelayBuffer.getCapacity();
+  if (bufferSize == 0) return;
 
-  if (bufferSize == 0) return std::vector<float>(16 * 32, 0.0f);
+  int currentWritePos = timing.writePosition;
+  int currentSeqPos = timing.sequencePosition;
+  double samplesToNextBeat = timing.samplesToNextBeat;
 
-  int currentWritePos = mWritePosition; 
-  int currentSeqPos = mSequencePosition;
-  double samplesToNextBeat = mSamplesToNextBeat.load();
-  
-  const auto* channelData = mDelayBuffer.getReadPointer(0); // Use Left channel for visualization
 
   // Loop through 0..15 corresponding to the 16 steps of the sequence.
   for (int stepIndex = 0; stepIndex < 16; ++stepIndex) {
@@ -68,10 +144,8 @@ std::vector<float> AmenBreakChopperAudioProcessor::getWaveformData() {
       // The user requested to hide this.
       // mSequencePosition is the NEXT step index. So (current - 1) is Actively Playing.
       int activeStep = (currentSeqPos - 1 + 16) % 16;
-      if (stepIndex == activeStep) {
-          for (int i = 0; i < 32; ++i) waveformData.push_back(0.0f);
-          continue;
-      }
+      if (stepIndex == activeStep)
+          continue; // Already zeroed
       
       // Logic:
       // "Current Step" (the one defined by currentSeqPos - 1) ends at "currentWritePos + samplesToNextBeat".
@@ -116,17 +190,22 @@ std::vector<float> AmenBreakChopperAudioProcessor::getWaveformData() {
       int len = endIdx - startIdx;
       if (len <= 0) len = 1; 
       
-      for (int i = 0; i < 32; ++i) {
-          int samplePos = startIdx + (i * len) / 32;
-          
-          while (samplePos < 0) samplePos += bufferSize;
-          while (samplePos >= bufferSize) samplePos -= bufferSize;
-          
-          waveformData.push_back(channelData[samplePos]);
+      // Each bin keeps the min/max of its span, quantised to int8
+      std::array<WaveformSummary::Bin, kWaveformBins> bins;
+      mWaveformSummary.getBins(startIdx, len, bins.data(), kWaveformBins);
+
+      auto *stepFrame = frame.data() + stepIndex * kWaveformBins * 2;
+      for (int i = 0; i < kWaveformBins; ++i) {
+          stepFrame[i * 2] = quantiseWaveformSample(bins[i].min);
+          stepFrame[i * 2 + 1] = quantiseWaveformSample(bins[i].max);
       }
   }
+}
 
-  return waveformData;
+juce::int8
+AmenBreakChopperAudioProcessor::quantiseWaveformSample(float sample) {
+  return static_cast<juce::int8>(
+      juce::roundToInt(juce::jlimit(-1.0f, 1.0f, sample) * 127.0f));
 }
 
 //==============================================================================
@@ -139,6 +218,12 @@ AmenBreakChopperAudioProcessor::createParameterLayout() {
   layout.add(std::make_unique<juce::AudioParameterChoice>(
       "controlMode", "Control Mode", controlModes, 0));
 
+  // Same messages as OSC, through a memory-mapped queue when the Controller
+  // runs on this host; OSC stays the fallback.
+  juce::StringArray oscTransports = {"UDP", "Shared Memory"};
+  layout.add(std::make_unique<juce::AudioParameterChoice>(
+      "oscTransport", "OSC Transport", oscTransports, 0));
+
   // Standalone / Sync Settings
   juce::StringArray bpmModes = {"Host", "MIDI Clock"};
   layout.add(std::make_unique<juce::AudioParameterChoice>(
@@ -192,6 +277,47 @@ AmenBreakChopperAudioProcessor::createParameterLayout() {
   layout.add(std::make_unique<juce::AudioParameterInt>(
       "delayAdjustCcStep", "Delay Adjust CC Step", 1, 128, 64));
 
+  // Crossfade between read heads when the delay time changes
+  layout.add(std::make_unique<juce::AudioParameterFloat>(
+      "chopFadeMs", "Chop Fade (ms)",
+      juce::NormalisableRange<float>(0.0f, kMaxChopFadeMs, 0.1f), 3.0f));
+
+  // Read head interpolation for fractional delay positions
+  juce::StringArray interpolationModes = {"None", "Linear", "Hermite"};
+  layout.add(std::make_unique<juce::AudioParameterChoice>(
+      "delayInterpolation", "Delay Interpolation", interpolationModes, 1));
+
+  // Merge each tick's or each block's outgoing OSC messages into one bundle
+  juce::StringArray oscBundlingModes = {"Off", "Per Tick", "Per Block"};
+  layout.add(std::make_unique<juce::AudioParameterChoice>(
+      "oscBundling", "OSC Bundling", oscBundlingModes, 0));
+
+  // Stamp each tick with its time, so the Controller can place its MIDI on
+  // the matching sample
+  layout.add(std::make_unique<juce::AudioParameterBool>(
+      "oscTimeTags", "OSC Time Tags", false));
+
+  // Loop bandwidth of the MIDI clock follower
+  layout.add(std::make_unique<juce::AudioParameterFloat>(
+      "midiClockBandwidth", "MIDI Clock Bandwidth (Hz)",
+      juce::NormalisableRange<float>(0.1f, 5.0f, 0.01f, 0.5f), 1.0f));
+
+  // Slowest tempo the delay buffer is sized for. Not automatable: every
+  // change reallocates the buffer with processing suspended.
+  layout.add(std::make_unique<juce::AudioParameterInt>(
+      "minTempo", "Min Tempo (BPM)", 20, 200, 60,
+      juce::AudioParameterIntAttributes().withAutomatable(false)));
+
+  // Slice voices triggered by notes 16-31
+  layout.add(std::make_unique<juce::AudioParameterInt>(
+      "voiceCount", "Slice Voices", 1, kMaxVoices, 4));
+  juce::StringArray voiceLengths = {"1/32", "1/16", "1/8", "1/4"};
+  layout.add(std::make_unique<juce::AudioParameterChoice>(
+      "voiceLength", "Slice Voice Length", voiceLengths, 1));
+  layout.add(std::make_unique<juce::AudioParameterFloat>(
+      "voiceLevel", "Slice Voice Level",
+      juce::NormalisableRange<float>(0.0f, 1.0f, 0.01f), 0.8f));
+
   // Visual Settings
   juce::StringArray themeNames = {"Green",  "Blue", "Purple", "Red",
                                   "Orange", "Cyan", "Pink"};
@@ -203,27 +329,159 @@ AmenBreakChopperAudioProcessor::createParameterLayout() {
 
 void AmenBreakChopperAudioProcessor::parameterChanged(
     const juce::String &parameterID, float newValue) {
+  if (mHeadless && parameterID.startsWith("osc"))
+    return;
+
   if (parameterID == "oscSendPort") {
     auto hostAddress =
         mValueTreeState.state.getProperty("oscHostAddress").toString();
-    if (!mSender.connect(hostAddress, (int)newValue))
+    if (!mOscSender.connect(hostAddress, (int)newValue))
       juce::Logger::writeToLog(
           "AmenBreakChopper: Failed to connect OSC sender on port change.");
+    updateSharedMemoryTransport();
   } else if (parameterID == "oscReceivePort") {
     if (!mReceiver.connect((int)newValue))
       juce::Logger::writeToLog(
           "AmenBreakChopper: Failed to connect OSC receiver on port change.");
+    updateSharedMemoryTransport();
+  } else if (parameterID == "oscTransport") {
+    updateSharedMemoryTransport();
+  } else if (parameterID == "delayTime") {
+    // Our own publication echoes back here with the value being published;
+    // anything else is a foreign change for the audio thread, even if it
+    // lands while the timer is publishing.
+    const int value = juce::roundToInt(newValue);
+    if (value != mDelayTimeEcho.load())
+      mExternalDelayTime.store(value);
+  } else if (parameterID == "delayAdjust") {
+    const int value = juce::roundToInt(newValue);
+    if (value != mDelayAdjustEcho.load())
+      mExternalDelayAdjust.store(value);
+  } else if (parameterID == "minTempo") {
+    mDelayBufferResizePending.store(true); // Applied by timerCallback
+  }
+}
+
+void AmenBreakChopperAudioProcessor::setDelayTimeState(int newDelayTime) {
+  mDelayTimeState = newDelayTime;
+  mPublishedDelayTime.store(newDelayTime);
+}
+
+void AmenBreakChopperAudioProcessor::setDelayAdjustState(int newDelayAdjust) {
+  const auto range = mParams.delayAdjust->getRange();
+  mDelayAdjustState =
+      juce::jlimit(range.getStart(), range.getEnd(), newDelayAdjust);
+  mPublishedDelayAdjust.store(mDelayAdjustState);
+}
+
+void AmenBreakChopperAudioProcessor::publishParameter(
+    juce::RangedAudioParameter *parameter, int value) {
+  const float normalised = parameter->convertTo0to1(static_cast<float>(value));
+  if (parameter->getValue() != normalised)
+    parameter->setValueNotifyingHost(normalised);
+}
+
+void AmenBreakChopperAudioProcessor::timerCallback() {
+  // Only the latest value of each parameter is sent to the host.
+  const int delayTime = mPublishedDelayTime.load();
+  mDelayTimeEcho.store(delayTime);
+  publishParameter(mParams.delayTime, delayTime);
+  mDelayTimeEcho.store(-1);
+  const int delayAdjust = mPublishedDelayAdjust.load();
+  mDelayAdjustEcho.store(delayAdjust);
+  publishParameter(mParams.delayAdjust, delayAdjust);
+  mDelayAdjustEcho.store(kNoDelayAdjust);
+  publishParameter(mParams.sequencePosition, mSequencePosition.load());
+  publishParameter(mParams.noteSequencePosition,
+                   mPublishedNoteSequencePosition.load());
+
+  // Reallocating under suspendProcessing waits for a running processBlock
+  // and keeps the host from calling it until the new buffer is in place.
+  if (mDelayBufferResizePending.exchange(false) &&
+      mDelayBuffer.getCapacity() > 0) {
+    const int size = getRequiredDelayBufferSize();
+    if (size != mDelayBuffer.getCapacity() ||
+        getDelayBlockMargin() != mDelayBlockMargin) {
+      suspendProcessing(true);
+      allocateDelayBuffer(size);
+      suspendProcessing(false);
+    }
   }
 }
 
+int AmenBreakChopperAudioProcessor::getDelayBlockMargin() const {
+  return juce::jmax(mMaxBlockSize, mLargestBlockSize.load()) + kBlockHeadroom;
+}
+
+int AmenBreakChopperAudioProcessor::getRequiredDelayBufferSize() const {
+  const double minTempo = juce::jmax(1.0f, mParams.minTempo->load());
+  const auto adjustRange = mParams.delayAdjust->getRange();
+  const int maxDelayAdjustMs = juce::jmax(std::abs(adjustRange.getStart()),
+                                          std::abs(adjustRange.getEnd()));
+
+  // 16 eighth notes covers the longest chop (15) and the waveform display
+  const double samples = 16.0 * 30.0 / minTempo * mSampleRate +
+                         maxDelayAdjustMs * 0.001 * mSampleRate +
+                         getDelayBlockMargin() + 4; // Hermite taps
+  return juce::nextPowerOfTwo(static_cast<int>(std::ceil(samples)));
+}
+
+void AmenBreakChopperAudioProcessor::allocateDelayBuffer(int size) {
+  jassert(juce::isPowerOfTwo(size));
+  const CheckedCriticalSection::ScopedLockType sl(mWaveformLock);
+  mDelayBuffer.setSize(2, size); // Fixed 2 channels (Stereo), cleared
+  mDelayBlockMargin = getDelayBlockMargin();
+  mMaxDelayInSamples = static_cast<double>(size - mDelayBlockMargin - 4);
+  mWritePosition = 0;
+  mVoices.fill(Voice()); // Their delays may not fit the new buffer
+  mWaveformSummary.prepare(size);
+  mWaveformTiming = WaveformTiming();
+}
+
 void AmenBreakChopperAudioProcessor::setOscHostAddress(
     const juce::String &hostAddress) {
   mValueTreeState.state.setProperty("oscHostAddress", hostAddress, nullptr);
+  if (mHeadless)
+    return;
   auto sendPort =
       (int)mValueTreeState.getRawParameterValue("oscSendPort")->load();
-  if (!mSender.connect(hostAddress, sendPort))
+  if (!mOscSender.connect(hostAddress, sendPort))
     juce::Logger::writeToLog(
         "AmenBreakChopper: Failed to connect OSC sender on host change.");
+  updateSharedMemoryTransport();
+}
+
+void AmenBreakChopperAudioProcessor::updateSharedMemoryTransport() {
+  const bool useSharedMemory =
+      mValueTreeState.getRawParameterValue("oscTransport")->load() >= 0.5f;
+  auto hostAddress =
+      mValueTreeState.state.getProperty("oscHostAddress").toString();
+  auto sendPort =
+      (int)mValueTreeState.getRawParameterValue("oscSendPort")->load();
+  auto receivePort =
+      (int)mValueTreeState.getRawParameterValue("oscReceivePort")->load();
+
+  // Only a peer on this host can share the queue
+  mOscSender.setSharedMemoryPort(
+      useSharedMemory && OscSenderThread::isLocalHost(hostAddress) ? sendPort
+                                                                   : 0);
+
+  const CheckedSpinLock::ScopedLockType lock(mSharedInputLock);
+  mSharedInput.close();
+  if (!useSharedMemory)
+    return;
+
+  using OpenResult = OscSenderThread::SharedQueue::OpenResult;
+  const auto result = mSharedInput.openAsConsumer(
+      OscSenderThread::SharedQueue::getFileForPort(receivePort));
+  if (result == OpenResult::inUse)
+    juce::Logger::writeToLog("AmenBreakChopper: Shared memory queue for port " +
+                             juce::String(receivePort) +
+                             " is used by another instance, receiving over "
+                             "OSC only.");
+  else if (result == OpenResult::failed)
+    juce::Logger::writeToLog(
+        "AmenBreakChopper: Failed to open shared memory queue.");
 }
 
 void AmenBreakChopperAudioProcessor::performSequenceReset() {
@@ -295,31 +553,57 @@ void AmenBreakChopperAudioProcessor::changeProgramName(
 //==============================================================================
 void AmenBreakChopperAudioProcessor::prepareToPlay(double sampleRate,
                                                    int samplesPerBlock) {
-  // OSC Sender
-  auto hostAddress =
-      mValueTreeState.state.getProperty("oscHostAddress").toString();
-  auto sendPort =
-      (int)mValueTreeState.getRawParameterValue("oscSendPort")->load();
-  if (!mSender.connect(hostAddress, sendPort))
-    juce::Logger::writeToLog("AmenBreakChopper: Failed to connect OSC sender.");
+  if (!mHeadless) {
+    // OSC Sender
+    auto hostAddress =
+        mValueTreeState.state.getProperty("oscHostAddress").toString();
+    auto sendPort =
+        (int)mValueTreeState.getRawParameterValue("oscSendPort")->load();
+    if (!mOscSender.connect(hostAddress, sendPort))
+      juce::Logger::writeToLog(
+          "AmenBreakChopper: Failed to connect OSC sender.");
+    mOscSender.startSending();
 
-  // OSC Receiver
-  auto receivePort =
-      (int)mValueTreeState.getRawParameterValue("oscReceivePort")->load();
-  mReceiver.connect(receivePort);
-    juce::Logger::writeToLog(
-        "AmenBreakChopper: Failed to connect OSC receiver.");
+    // OSC Receiver
+    auto receivePort =
+        (int)mValueTreeState.getRawParameterValue("oscReceivePort")->load();
+    if (!mReceiver.connect(receivePort))
+      juce::Logger::writeToLog(
+          "AmenBreakChopper: Failed to connect OSC receiver.");
+    updateSharedMemoryTransport();
+  }
 
-  mMidiClockTracker.reset();
+  mMidiClockTracker.prepare(sampleRate);
+  mProcessedMidi.ensureSize(kMidiOutputReserveBytes);
+  mMidiClockPpq = 0.0;
+  mMidiClockWasLocked = false;
+  mSampleCounter = 0;
   mSampleRate = sampleRate;
+  mMaxBlockSize = samplesPerBlock;
+  mLargestBlockSize.store(samplesPerBlock);
 
   // We enforce a Stereo internal buffer for the delay/looping logic.
   // Input routing will map selected inputs to this stereo pair.
-  const int delayBufferSize =
-      static_cast<int>(16.0 * sampleRate); // 16 seconds max delay
-
-  mDelayBuffer.setSize(2, delayBufferSize); // Fixed 2 channels (Stereo)
-  mDelayBuffer.clear();
+  mDelayBufferResizePending.store(false);
+  allocateDelayBuffer(getRequiredDelayBufferSize());
+
+  // Crossfade tables and scratch space for the second read head
+  const auto maxFadeSamples =
+      static_cast<size_t>(std::ceil(kMaxChopFadeMs * 0.001 * sampleRate));
+  mFadeInTable.assign(maxFadeSamples, 0.0f);
+  mFadeOutTable.assign(maxFadeSamples, 0.0f);
+  mFadeTableLength = 0;
+  mFadeScratch.setSize(2, juce::jmax(1, samplesPerBlock));
+  mVoiceScratch.setSize(2, juce::jmax(1, samplesPerBlock));
+  mNumVoiceEvents = 0;
+  mCurrentDelayTime = 0;
+  mExternalDelayTime.store(-1);
+  setDelayTimeState(static_cast<int>(mParams.delayTimeValue->load()));
+  mExternalDelayAdjust.store(kNoDelayAdjust);
+  setDelayAdjustState(mParams.delayAdjust->get());
+  mFadeFromDelayTime = 0;
+  mFadePosition = 0;
+  mFadeLength = 0;
 
   // Initialize sequencer state
   mNextEighthNotePpq = 0.0;
@@ -340,7 +624,19 @@ void AmenBreakChopperAudioProcessor::prepareToPlay(double sampleRate,
 }
 
 void AmenBreakChopperAudioProcessor::releaseResources() {
+  mOscSender.stopSending();
+  {
+    const CheckedSpinLock::ScopedLockType lock(mSharedInputLock);
+    mSharedInput.close(); // Lets the Controller fall back to OSC at once
+  }
+  if (const int dropped = mNumDroppedOscCommands.exchange(0))
+    juce::Logger::writeToLog("AmenBreakChopper: " + juce::String(dropped) +
+                             " OSC commands dropped, queue full.");
+  RealtimeGuard::writeReport("AmenBreakChopper");
+
+  const CheckedCriticalSection::ScopedLockType sl(mWaveformLock);
   mDelayBuffer.setSize(0, 0);
+  mWaveformSummary.prepare(0);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -380,9 +676,357 @@ bool AmenBreakChopperAudioProcessor::shouldTriggerReset(int mode,
   }
 }
 
+void AmenBreakChopperAudioProcessor::addDelaySegment(int startSample,
+                                                     int delayTime) {
+  // Ticks before the block start (e.g. after a delayAdjust jump) are applied
+  // from the first sample.
+  startSample = juce::jmax(0, startSample);
+
+  if (mNumDelaySegments > 0) {
+    auto &last = mDelaySegments[(size_t)mNumDelaySegments - 1];
+    if (last.delayTime == delayTime)
+      return;
+    // Several changes on the same sample (or a full list): the latest wins.
+    if (last.startSample >= startSample ||
+        mNumDelaySegments == kMaxDelaySegments) {
+      last.delayTime = delayTime;
+      return;
+    }
+  }
+
+  mDelaySegments[(size_t)mNumDelaySegments++] = {startSample, delayTime};
+}
+
+void AmenBreakChopperAudioProcessor::writeDelayChannel(int channel,
+                                                       const float *source,
+                                                       int numSamples) {
+  const auto spans =
+      mDelayBuffer.getWriteSpans(channel, mWritePosition, numSamples);
+
+  if (source != nullptr) {
+    juce::FloatVectorOperations::copy(spans.first, source, spans.firstSize);
+    if (spans.secondSize > 0)
+      juce::FloatVectorOperations::copy(spans.second, source + spans.firstSize,
+                                        spans.secondSize);
+  } else {
+    juce::FloatVectorOperations::clear(spans.first, spans.firstSize);
+    if (spans.secondSize > 0)
+      juce::FloatVectorOperations::clear(spans.second, spans.secondSize);
+  }
+}
+
+void AmenBreakChopperAudioProcessor::readDelayTap(int channel, float *dest,
+                                                  int position,
+                                                  int numSamples, float gain,
+                                                  bool accumulate) const {
+  auto processRun = [gain, accumulate](float *d, const float *s, int num) {
+    if (accumulate)
+      juce::FloatVectorOperations::addWithMultiply(d, s, gain, num);
+    else if (gain == 1.0f)
+      juce::FloatVectorOperations::copy(d, s, num);
+    else
+      juce::FloatVectorOperations::copyWithMultiply(d, s, gain, num);
+  };
+
+  // Negative positions wrap too
+  const auto spans = mDelayBuffer.getReadSpans(channel, position, numSamples);
+
+  processRun(dest, spans.first, spans.firstSize);
+  if (spans.secondSize > 0)
+    processRun(dest + spans.firstSize, spans.second, spans.secondSize);
+}
+
+void AmenBreakChopperAudioProcessor::readDelayChannel(
+    int channel, float *dest, int startSample, int numSamples,
+    double delayInSamples) const {
+  // Read position for output sample k is (write + k - delay). Split the delay
+  // into a whole part and the fraction t that sits between tap x0 and x1.
+  const double wholeDelay = std::ceil(delayInSamples);
+  const auto t = static_cast<float>(wholeDelay - delayInSamples);
+  const int x0 = mWritePosition + startSample - static_cast<int>(wholeDelay);
+
+  if (mDelayInterpolation == DelayInterpolation::none || t == 0.0f) {
+    const int nearest = (t < 0.5f) ? x0 : x0 + 1;
+    readDelayTap(channel, dest, nearest, numSamples, 1.0f, false);
+    return;
+  }
+
+  if (mDelayInterpolation == DelayInterpolation::linear) {
+    readDelayTap(channel, dest, x0, numSamples, 1.0f - t, false);
+    readDelayTap(channel, dest, x0 + 1, numSamples, t, true);
+    return;
+  }
+
+  // 4-point, 3rd-order Hermite (Catmull-Rom) over x-1 .. x2
+  const float t2 = t * t;
+  const float t3 = t2 * t;
+  const float cm1 = -0.5f * t3 + t2 - 0.5f * t;
+  const float c0 = 1.5f * t3 - 2.5f * t2 + 1.0f;
+  const float c1 = -1.5f * t3 + 2.0f * t2 + 0.5f * t;
+  const float c2 = 0.5f * t3 - 0.5f * t2;
+
+  readDelayTap(channel, dest, x0 - 1, numSamples, cm1, false);
+  readDelayTap(channel, dest, x0, numSamples, c0, true);
+  readDelayTap(channel, dest, x0 + 1, numSamples, c1, true);
+  readDelayTap(channel, dest, x0 + 2, numSamples, c2, true);
+}
+
+void AmenBreakChopperAudioProcessor::updateFadeTables(int lengthInSamples) {
+  // Tables are sized for kMaxChopFadeMs in prepareToPlay, so rebuilding them
+  // when chopFadeMs changes never allocates.
+  lengthInSamples =
+      juce::jmin(lengthInSamples, static_cast<int>(mFadeInTable.size()));
+
+  for (int i = 0; i < lengthInSamples; ++i) {
+    const double phase = juce::MathConstants<double>::halfPi * (i + 0.5) /
+                         static_cast<double>(lengthInSamples);
+    mFadeInTable[(size_t)i] = static_cast<float>(std::sin(phase));
+    mFadeOutTable[(size_t)i] = static_cast<float>(std::cos(phase));
+  }
+  mFadeTableLength = lengthInSamples;
+}
+
+void AmenBreakChopperAudioProcessor::renderDelaySegment(
+    juce::AudioBuffer<float> &buffer, int numChannels, int startSample,
+    int numSamples, int delayTime, double eighthNoteSamples) {
+  // Kept fractional: truncating here made chops drift against the host grid
+  // at tempos such as 174.3 BPM.
+  // Below the minTempo floor, long chops read the oldest recorded audio
+  // rather than wrapping into the newest.
+  auto toSamples = [this, eighthNoteSamples](int steps) {
+    return juce::jmin(eighthNoteSamples * steps, mMaxDelayInSamples);
+  };
+
+  if (delayTime != mCurrentDelayTime) {
+    // If a fade is still running, carry on from whichever head currently
+    // dominates the output.
+    const bool fadeRunning = mFadePosition < mFadeLength;
+    if (!fadeRunning || mFadePosition >= mFadeLength / 2)
+      mFadeFromDelayTime = mCurrentDelayTime;
+    mCurrentDelayTime = delayTime;
+
+    if (mChopFadeSamples != mFadeTableLength)
+      updateFadeTables(mChopFadeSamples);
+    mFadeLength = mFadeTableLength;
+    mFadePosition = 0;
+  }
+
+  // Crossfade section: old head into the scratch buffer, new head in place.
+  while (numSamples > 0 && mFadePosition < mFadeLength) {
+    const int n = juce::jmin(numSamples, mFadeLength - mFadePosition,
+                             mFadeScratch.getNumSamples());
+    if (n <= 0)
+      break;
+    const float *fadeIn = mFadeInTable.data() + mFadePosition;
+    const float *fadeOut = mFadeOutTable.data() + mFadePosition;
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+      auto *output = buffer.getWritePointer(channel, startSample);
+      auto *previous = mFadeScratch.getWritePointer(channel);
+
+      if (mFadeFromDelayTime == 0)
+        juce::FloatVectorOperations::copy(previous, output, n);
+      else
+        readDelayChannel(channel, previous, startSample, n,
+                         toSamples(mFadeFromDelayTime));
+
+      if (delayTime != 0)
+        readDelayChannel(channel, output, startSample, n,
+                         toSamples(delayTime));
+
+      juce::FloatVectorOperations::multiply(output, fadeIn, n);
+      juce::FloatVectorOperations::addWithMultiply(output, previous, fadeOut,
+                                                   n);
+    }
+
+    mFadePosition += n;
+    startSample += n;
+    numSamples -= n;
+  }
+
+  // Steady state: a single read head, or the dry input for delay time 0.
+  if (numSamples > 0 && delayTime != 0)
+    for (int channel = 0; channel < numChannels; ++channel)
+      readDelayChannel(channel, buffer.getWritePointer(channel, startSample),
+                       startSample, numSamples, toSamples(delayTime));
+}
+
+void AmenBreakChopperAudioProcessor::startVoice(const VoiceEvent &event,
+                                                double delayInSamples,
+                                                int cycleLength,
+                                                double barLength) {
+  const int numVoices =
+      juce::jlimit(1, kMaxVoices, (int)mParams.voiceCount->load());
+
+  // A free voice, else the oldest released one, else the oldest held one
+  Voice *target = nullptr;
+  for (int i = 0; i < numVoices && target == nullptr; ++i)
+    if (!mVoices[(size_t)i].active)
+      target = &mVoices[(size_t)i];
+
+  if (target == nullptr) {
+    for (int i = 0; i < numVoices; ++i) {
+      auto &voice = mVoices[(size_t)i];
+      if (target == nullptr || (target->held && !voice.held) ||
+          (target->held == voice.held &&
+           (juce::int32)(voice.startOrder - target->startOrder) < 0))
+        target = &voice;
+    }
+  }
+
+  target->active = true;
+  target->held = true;
+  target->slice = event.slice;
+  target->delayInSamples =
+      juce::jlimit(kMinVoiceDelaySamples, mMaxDelayInSamples, delayInSamples);
+  target->cycleLength = cycleLength;
+  target->cyclePosition = 0;
+  target->barLength = barLength;
+  target->rampLength =
+      juce::jmax(1, juce::jmin(cycleLength / 4, mChopFadeSamples));
+  target->gain = event.gain * mParams.voiceLevel->load();
+  target->startOrder = ++mVoiceStartCounter;
+}
+
+void AmenBreakChopperAudioProcessor::renderVoices(
+    juce::AudioBuffer<float> &buffer, int numChannels, int numSamples,
+    double ppqAtStartOfBlock, double ppqPerSample, double eighthNoteSamples,
+    bool isPlaying) {
+  if (!(eighthNoteSamples > 0.0) || !std::isfinite(eighthNoteSamples)) {
+    mNumVoiceEvents = 0; // No tempo yet (e.g. MIDI clock not running)
+    return;
+  }
+
+  const double cycleBeats =
+      0.125 * (double)(1 << (int)mParams.voiceLength->load());
+  const int cycleLength = juce::jmax(
+      1, static_cast<int>(cycleBeats * 2.0 * eighthNoteSamples));
+
+  // The tick loop has run for the whole block: the last tick started step
+  // mSequencePosition - 1 at lastTickPpq.
+  const double lastTickPpq = mNextEighthNotePpq - 0.5;
+
+  int position = 0;
+  for (int e = 0; e <= mNumVoiceEvents; ++e) {
+    const int eventSample =
+        e < mNumVoiceEvents
+            ? juce::jlimit(0, numSamples, mVoiceEvents[(size_t)e].sample)
+            : numSamples;
+
+    if (eventSample > position) {
+      for (auto &voice : mVoices)
+        if (voice.active)
+          renderVoice(voice, buffer, numChannels, position,
+                      eventSample - position);
+      position = eventSample;
+    }
+    if (e == mNumVoiceEvents)
+      break;
+
+    const auto &event = mVoiceEvents[(size_t)e];
+    if (event.gain <= 0.0f) {
+      // Note off: let the current repeat finish, then stop rolling
+      for (auto &voice : mVoices)
+        if (voice.active && voice.held && voice.slice == event.slice)
+          voice.held = false;
+      continue;
+    }
+
+    // Read the slice from its start: whole steps back to it, plus how far
+    // the step playing at the trigger has already run.
+    int currentStep = mSequencePosition.load();
+    double intoStep = 0.0;
+    if (isPlaying && ppqPerSample > 0.0) {
+      const double triggerPpq = ppqAtStartOfBlock + eventSample * ppqPerSample;
+      const int stepsAgo =
+          juce::jmax(0, (int)std::ceil((lastTickPpq - triggerPpq) * 2.0));
+      currentStep = mSequencePosition.load() - 1 - stepsAgo;
+      intoStep =
+          juce::jmax(0.0, (triggerPpq - (lastTickPpq - stepsAgo * 0.5)) /
+                              ppqPerSample);
+    }
+    const int stepsBack = ((currentStep - event.slice) % 16 + 16) % 16;
+    startVoice(event, stepsBack * eighthNoteSamples + intoStep, cycleLength,
+               16.0 * eighthNoteSamples);
+  }
+
+  mNumVoiceEvents = 0;
+}
+
+void AmenBreakChopperAudioProcessor::renderVoice(
+    Voice &voice, juce::AudioBuffer<float> &buffer, int numChannels,
+    int startSample, int numSamples) {
+  // Linear attack and release at the edges of every repeat, flat in between
+  auto applyEnvelope = [&voice](float *samples, int cyclePosition, int num) {
+    const int releaseStart = voice.cycleLength - voice.rampLength;
+    for (int i = 0; i < num;) {
+      const int p = cyclePosition + i;
+      if (p >= voice.rampLength && p < releaseStart) {
+        const int run = juce::jmin(num - i, releaseStart - p);
+        juce::FloatVectorOperations::multiply(samples + i, voice.gain, run);
+        i += run;
+      } else {
+        const int fromEdge =
+            p < voice.rampLength ? p : voice.cycleLength - 1 - p;
+        samples[i] *= voice.gain * ((float)fromEdge + 0.5f) /
+                      (float)voice.rampLength;
+        ++i;
+      }
+    }
+  };
+
+  while (numSamples > 0 && voice.active) {
+    const int n = juce::jmin(numSamples,
+                             voice.cycleLength - voice.cyclePosition,
+                             mVoiceScratch.getNumSamples());
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+      auto *scratch = mVoiceScratch.getWritePointer(channel);
+      readDelayChannel(channel, scratch, startSample, n, voice.delayInSamples);
+      applyEnvelope(scratch, voice.cyclePosition, n);
+      juce::FloatVectorOperations::add(
+          buffer.getWritePointer(channel, startSample), scratch, n);
+    }
+
+    voice.cyclePosition += n;
+    startSample += n;
+    numSamples -= n;
+
+    if (voice.cyclePosition >= voice.cycleLength) {
+      // Rolling: the next repeat reads the same slice again, one cycle
+      // further back. Once the slice has been recorded again in a newer bar
+      // the roll moves to that copy, so a held note stays within one bar of
+      // the write head instead of running off the end of the buffer.
+      voice.cyclePosition = 0;
+      voice.delayInSamples += voice.cycleLength;
+      if (voice.delayInSamples - voice.barLength >= kMinVoiceDelaySamples)
+        voice.delayInSamples -= voice.barLength;
+      voice.active = voice.held && voice.delayInSamples <= mMaxDelayInSamples;
+    }
+  }
+}
+
 void AmenBreakChopperAudioProcessor::processBlock(
     juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages) {
   juce::ScopedNoDenormals noDenormals;
+  const ScopedRealtimeCheck realtimeCheck; // Debug builds, see RealtimeGuard.h
+  const double blockStartTime = OscTime::now(); // For OSC time tags
+  ++mOscBlock;
+
+  // --- Commands from the Controller, see mOscCommandQueue ---
+  OscSenderThread::Message command;
+  while (mOscCommandQueue.pop(command))
+    handleRemoteMessage(command);
+
+  {
+    const CheckedSpinLock::ScopedTryLockType lock(mSharedInputLock);
+    // setHeartbeat() fails once another instance has taken the queue over
+    if (lock.isLocked() && mSharedInput.isOpen() &&
+        mSharedInput.setHeartbeat(juce::Time::currentTimeMillis())) {
+      while (mSharedInput.pop(command))
+        handleRemoteMessage(command);
+    }
+  }
   auto totalNumInputChannels = getTotalNumInputChannels();
   auto totalNumOutputChannels = getTotalNumOutputChannels();
 
@@ -391,11 +1035,8 @@ void AmenBreakChopperAudioProcessor::processBlock(
     buffer.clear(i, 0, buffer.getNumSamples());
 
   // --- Parameters ---
-  auto *bpmModeParam = mValueTreeState.getRawParameterValue("bpmSyncMode");
-  bool useMidiClock = (bpmModeParam->load() >= 0.5f);
-
-  auto *inputEnabledParam = mValueTreeState.getRawParameterValue("inputEnabled");
-  bool inputEnabled = (inputEnabledParam->load() > 0.5f);
+  bool useMidiClock = (mParams.bpmSyncMode->load() >= 0.5f);
+  bool inputEnabled = (mParams.inputEnabled->load() > 0.5f);
 
   // FIX: If input is disabled, strictly clear the main buffer.
   // This prevents the "dry" signal from passing through when delayTime=0 or during processing gaps.
@@ -404,14 +1045,12 @@ void AmenBreakChopperAudioProcessor::processBlock(
       buffer.clear();
   }
 
-  int inputChanL = (int)mValueTreeState.getRawParameterValue("inputChanL")->load() - 1;
-  int inputChanR = (int)mValueTreeState.getRawParameterValue("inputChanR")->load() - 1;
+  int inputChanL = (int)mParams.inputChanL->load() - 1;
+  int inputChanR = (int)mParams.inputChanR->load() - 1;
 
   // --- Process incoming MIDI messages ---
-  const int midiInChannel =
-      (int)mValueTreeState.getRawParameterValue("midiInputChannel")->load();
-  const int midiOutChannel =
-      (int)mValueTreeState.getRawParameterValue("midiOutputChannel")->load();
+  const int midiInChannel = (int)mParams.midiInputChannel->load();
+  const int midiOutChannel = (int)mParams.midiOutputChannel->load();
 
   // Check for UI-triggered note invocation
   int uiNote = mUiTriggeredNote.exchange(-1);
@@ -419,20 +1058,30 @@ void AmenBreakChopperAudioProcessor::processBlock(
     mLastReceivedNoteValue = uiNote;
     mNoteSequencePosition = uiNote;
     mNewNoteReceived = true;
-    if (onNoteEvent)
-      onNoteEvent(uiNote, -1);
+    mNoteEvents.push({uiNote, -1});
   }
 
-  juce::MidiBuffer processedMidi; // Create a new buffer for our generated notes
+  mMidiClockTracker.setBandwidth(mParams.midiClockBandwidth->load());
+
+  // Host and UI changes first, so the delayAdjust CCs below step from them
+  const int externalDelayAdjust = mExternalDelayAdjust.exchange(kNoDelayAdjust);
+  if (externalDelayAdjust != kNoDelayAdjust)
+    setDelayAdjustState(externalDelayAdjust);
+
+  mProcessedMidi.clear(); // Reuses the storage reserved in prepareToPlay
+  mNumVoiceEvents = 0;
   for (const auto metadata : midiMessages) {
     auto message = metadata.getMessage();
     
     // --- MIDI Clock Handling ---
     if (message.isMidiClock()) {
-         mMidiClockTracker.processClockMessage(juce::Time::getMillisecondCounterHiRes() * 0.001);
+         // Timestamp at the tick's own sample, not at block processing time
+         mMidiClockTracker.processClockMessage(mSampleCounter +
+                                               metadata.samplePosition);
     } else if (message.isMidiStart()) {
          mSequencePosition = 0;
          mNoteSequencePosition = 0;
+         mMidiClockTracker.start();
          mMidiClockPpq = 0.0;
          mNextEighthNotePpq = 0.0;
     } else if (message.isMidiStop()) {
@@ -449,55 +1098,52 @@ void AmenBreakChopperAudioProcessor::processBlock(
               noteNumber; // MIDI note overrides the note sequence
           mNewNoteReceived = true;
 
-          if (onNoteEvent)
-            onNoteEvent(noteNumber, -1); // -1 indicates Input/Trigger
+          mNoteEvents.push({noteNumber, -1}); // -1 indicates Input/Trigger
+        } else if (noteNumber >= kFirstVoiceNote &&
+                   noteNumber < kFirstVoiceNote + 16 &&
+                   mNumVoiceEvents < kMaxVoiceEvents) {
+          mVoiceEvents[(size_t)mNumVoiceEvents++] = {
+              metadata.samplePosition, noteNumber - kFirstVoiceNote,
+              message.getFloatVelocity()};
         }
+      } else if (message.isNoteOff()) {
+        const int noteNumber = message.getNoteNumber();
+        if (noteNumber >= kFirstVoiceNote &&
+            noteNumber < kFirstVoiceNote + 16 &&
+            mNumVoiceEvents < kMaxVoiceEvents)
+          mVoiceEvents[(size_t)mNumVoiceEvents++] = {
+              metadata.samplePosition, noteNumber - kFirstVoiceNote, 0.0f};
       } else if (message.isController()) {
         const int controllerNumber = message.getControllerNumber();
         const int controllerValue = message.getControllerValue();
 
-        const int ccSeqReset =
-            (int)mValueTreeState.getRawParameterValue("midiCcSeqReset")->load();
-        const int ccHardReset =
-            (int)mValueTreeState.getRawParameterValue("midiCcHardReset")
-                ->load();
-        const int ccSoftReset =
-            (int)mValueTreeState.getRawParameterValue("midiCcSoftReset")
-                ->load();
+        const int ccSeqReset = (int)mParams.midiCcSeqReset->load();
+        const int ccHardReset = (int)mParams.midiCcHardReset->load();
+        const int ccSoftReset = (int)mParams.midiCcSoftReset->load();
 
         if (controllerNumber == ccSeqReset) {
-          const int mode =
-              (int)mValueTreeState.getRawParameterValue("midiCcSeqResetMode")
-                  ->load();
+          const int mode = (int)mParams.midiCcSeqResetMode->load();
           if (shouldTriggerReset(mode, mLastSeqResetCcValue, controllerValue))
             mSequenceResetQueued = true;
           mLastSeqResetCcValue = controllerValue;
         }
 
         if (controllerNumber == ccHardReset) {
-          const int mode =
-              (int)mValueTreeState.getRawParameterValue("midiCcHardResetMode")
-                  ->load();
+          const int mode = (int)mParams.midiCcHardResetMode->load();
           if (shouldTriggerReset(mode, mLastHardResetCcValue, controllerValue))
             mHardResetQueued = true;
           mLastHardResetCcValue = controllerValue;
         }
 
         if (controllerNumber == ccSoftReset) {
-          const int mode =
-              (int)mValueTreeState.getRawParameterValue("midiCcSoftResetMode")
-                  ->load();
+          const int mode = (int)mParams.midiCcSoftResetMode->load();
           if (shouldTriggerReset(mode, mLastSoftResetCcValue, controllerValue))
             mSoftResetQueued = true;
           mLastSoftResetCcValue = controllerValue;
         }
 
-        const int ccFwd =
-            (int)mValueTreeState.getRawParameterValue("midiCcDelayAdjustFwd")
-                ->load();
-        const int ccBwd =
-            (int)mValueTreeState.getRawParameterValue("midiCcDelayAdjustBwd")
-                ->load();
+        const int ccFwd = (int)mParams.midiCcDelayAdjustFwd->load();
+        const int ccBwd = (int)mParams.midiCcDelayAdjustBwd->load();
 
         // Detect press events (rising edge) for the current message
         bool fwdJustPressed =
@@ -515,23 +1161,15 @@ void AmenBreakChopperAudioProcessor::processBlock(
         // Check for reset condition: one button was just pressed while the
         // other was already held.
         if ((fwdJustPressed && bwdWasHeld) || (bwdJustPressed && fwdWasHeld)) {
-          auto *param = static_cast<juce::AudioParameterInt *>(
-              mValueTreeState.getParameter("delayAdjust"));
-          param->operator=(0);
+          setDelayAdjustState(0);
         }
         // If no reset, handle single press actions.
         else if (fwdJustPressed) {
-          auto *stepParam = static_cast<juce::AudioParameterInt *>(
-              mValueTreeState.getParameter("delayAdjustCcStep"));
-          auto *param = static_cast<juce::AudioParameterInt *>(
-              mValueTreeState.getParameter("delayAdjust"));
-          param->operator=(param->get() + stepParam->get());
+          setDelayAdjustState(mDelayAdjustState +
+                              mParams.delayAdjustCcStep->get());
         } else if (bwdJustPressed) {
-          auto *stepParam = static_cast<juce::AudioParameterInt *>(
-              mValueTreeState.getParameter("delayAdjustCcStep"));
-          auto *param = static_cast<juce::AudioParameterInt *>(
-              mValueTreeState.getParameter("delayAdjust"));
-          param->operator=(param->get() - stepParam->get());
+          setDelayAdjustState(mDelayAdjustState -
+                              mParams.delayAdjustCcStep->get());
         }
 
         // Finally, update the 'last value' state keepers for the next
@@ -557,9 +1195,18 @@ void AmenBreakChopperAudioProcessor::processBlock(
   double ppqAtStartOfBlock = 0.0;
   bool isPlaying = true; // Default to running for internal/standalone
 
+  const bool clockLocked = useMidiClock && mMidiClockTracker.isLocked();
   if (useMidiClock) {
       bpm = mMidiClockTracker.detectedBpm;
-      ppqAtStartOfBlock = mMidiClockPpq;
+      // Locked to the tick count once ticks arrive, free-running before that
+      ppqAtStartOfBlock = clockLocked
+                              ? mMidiClockTracker.getPpqAt(mSampleCounter)
+                              : mMidiClockPpq;
+      // Ticks without a Start restart the count below the free-running
+      // phase. Follow the tick count from here instead of waiting for it to
+      // catch up with the old next tick.
+      if (clockLocked && !mMidiClockWasLocked)
+        mNextEighthNotePpq = std::ceil(ppqAtStartOfBlock * 2.0) / 2.0;
       // We assume playing if using MIDI clock logic (or check clock active?)
       isPlaying = true; 
   } else {
@@ -571,10 +1218,10 @@ void AmenBreakChopperAudioProcessor::processBlock(
   // Reset logic updates
   if (mHardResetQueued || mSoftResetQueued) {
     if (mLastNote1 >= 0)
-      processedMidi.addEvent(
+      mProcessedMidi.addEvent(
           juce::MidiMessage::noteOff(midiOutChannel, mLastNote1), 0);
     if (mLastNote2 >= 0)
-      processedMidi.addEvent(
+      mProcessedMidi.addEvent(
           juce::MidiMessage::noteOff(midiOutChannel, mLastNote2), 0);
     mLastNote1 = -1;
     mLastNote2 = -1;
@@ -583,20 +1230,14 @@ void AmenBreakChopperAudioProcessor::processBlock(
   if (mHardResetQueued) {
     mSequencePosition = 0;
     mNoteSequencePosition = 0;
-    mValueTreeState.getParameter("sequencePosition")
-        ->setValueNotifyingHost(0.0f);
-    mValueTreeState.getParameter("noteSequencePosition")
-        ->setValueNotifyingHost(0.0f);
+    mPublishedNoteSequencePosition.store(0);
 
     if (isPlaying) {
       // Also reset PPQ tracking to the current tick
       mNextEighthNotePpq = std::ceil(ppqAtStartOfBlock * 2.0) / 2.0;
 
       // Apply the current delayAdjust as a phase offset on reset
-      const int currentDelayAdjust =
-          static_cast<juce::AudioParameterInt *>(
-              mValueTreeState.getParameter("delayAdjust"))
-              ->get();
+      const int currentDelayAdjust = mDelayAdjustState;
 
       
       // Conversion from MS to PPQ
@@ -626,17 +1267,29 @@ void AmenBreakChopperAudioProcessor::processBlock(
   }
 
   // Update BPM for UI
-  mCurrentBpm.store(bpm);
   mUsingMidiClock.store(useMidiClock); // For UI
 
   // --- Sequencer Tick Logic (Block-based) ---
   const int bufferLength = buffer.getNumSamples();
-  double ppqAtEndOfBlock = ppqAtStartOfBlock + (bufferLength * ppqPerSample);
+  // A locked clock is clamped at the next tick at both ends of the block
+  double ppqAtEndOfBlock =
+      clockLocked
+          ? mMidiClockTracker.getPpqAt(mSampleCounter + bufferLength)
+          : ppqAtStartOfBlock + (bufferLength * ppqPerSample);
+
+  // The delay time in effect when the block starts. Ticks inside the block
+  // append further segments at their exact sample offsets.
+  const int externalDelayTime = mExternalDelayTime.exchange(-1);
+  if (externalDelayTime >= 0)
+    setDelayTimeState(externalDelayTime);
+  mNumDelaySegments = 0;
+  addDelaySegment(0, mDelayTimeState);
   
   // Advance MIDI Clock PPQ for next block
   if (useMidiClock) {
       mMidiClockPpq = ppqAtEndOfBlock;
   }
+  mMidiClockWasLocked = clockLocked;
 
   if (isPlaying) {
     // ... Logic continues below (reused) ...
@@ -644,9 +1297,7 @@ void AmenBreakChopperAudioProcessor::processBlock(
 
 
   // --- Apply delayAdjust to sequencer phase ---
-  auto *delayAdjustParam = static_cast<juce::AudioParameterInt *>(
-      mValueTreeState.getParameter("delayAdjust"));
-  const int currentDelayAdjust = delayAdjustParam->get();
+  const int currentDelayAdjust = mDelayAdjustState;
   const int deltaDelayAdjust = currentDelayAdjust - mLastDelayAdjust;
 
   if (deltaDelayAdjust != 0) {
@@ -669,8 +1320,8 @@ void AmenBreakChopperAudioProcessor::processBlock(
 
     if (mSequenceResetQueued) {
       mNoteSequencePosition = mSequencePosition; // Sync Note-Seq to Main-Seq
-      mValueTreeState.getParameter("delayTime")
-          ->setValueNotifyingHost(0.0f); // Reset DelayTime
+      setDelayTimeState(0); // Reset DelayTime
+      addDelaySegment(tickSample, 0);
       mNewNoteReceived = false;
       mSequenceResetQueued = false;
     }
@@ -684,19 +1335,27 @@ void AmenBreakChopperAudioProcessor::processBlock(
     if (mNewNoteReceived) {
       const int diff = mSequencePosition - mLastReceivedNoteValue;
       const int newDelayTime = (diff % 16 + 16) % 16;
-      mValueTreeState.getParameter("delayTime")
-          ->setValueNotifyingHost(static_cast<float>(newDelayTime) / 15.0f);
+      setDelayTimeState(newDelayTime);
+      addDelaySegment(tickSample, newDelayTime);
     }
 
-    mValueTreeState.getParameter("sequencePosition")
-        ->setValueNotifyingHost(static_cast<float>(mSequencePosition.load()) / 15.0f);
-    mValueTreeState.getParameter("noteSequencePosition")
-        ->setValueNotifyingHost(static_cast<float>(mNoteSequencePosition) /
-                                15.0f);
-
-    mSender.send(juce::OSCMessage("/sequencePosition", mSequencePosition.load()));
-    mSender.send(
-        juce::OSCMessage("/noteSequencePosition", mNoteSequencePosition));
+    mPublishedNoteSequencePosition.store(mNoteSequencePosition);
+
+    // Encoded and sent by the OSC sender thread
+    if (!mHeadless) {
+      mOscSender.setBundleMode(static_cast<OscSenderThread::BundleMode>(
+          static_cast<int>(mParams.oscBundling->load())));
+      ++mOscTick;
+      const double tickTime = mParams.oscTimeTags->load() >= 0.5f
+                                  ? blockStartTime + tickSample / sampleRate
+                                  : 0.0;
+      mOscSender.post({OscSenderThread::Address::sequencePosition, true,
+                       mSequencePosition.load(), mOscTick, mOscBlock,
+                       tickTime});
+      mOscSender.post({OscSenderThread::Address::noteSequencePosition, true,
+                       mNoteSequencePosition, mOscTick, mOscBlock,
+                       tickTime});
+    }
 
     const int note1 = mNoteSequencePosition;
     const int note2 = 32 + mSequencePosition;
@@ -704,24 +1363,25 @@ void AmenBreakChopperAudioProcessor::processBlock(
 
     // Send Note Off for the previous note if it's valid
     if (mLastNote1 >= 0)
-      processedMidi.addEvent(
+      mProcessedMidi.addEvent(
           juce::MidiMessage::noteOff(midiOutChannel, mLastNote1), tickSample);
     if (mLastNote2 >= 0)
-      processedMidi.addEvent(
+      mProcessedMidi.addEvent(
           juce::MidiMessage::noteOff(midiOutChannel, mLastNote2), tickSample);
 
     // Send Note On for the current note
-    processedMidi.addEvent(
+    mProcessedMidi.addEvent(
         juce::MidiMessage::noteOn(midiOutChannel, note1, velocity), tickSample);
-    processedMidi.addEvent(
+    mProcessedMidi.addEvent(
         juce::MidiMessage::noteOn(midiOutChannel, note2, velocity), tickSample);
 
     // Store the current note as the last one for the next tick
     mLastNote1 = note1;
     mLastNote2 = note2;
 
-    if (onNoteEvent)
-      onNoteEvent(note1, note2); // note1 = 0-15 (Seq), note2 = 32-47 (Original)
+    // note1 = 0-15 (Seq), note2 = 32-47 (Original). If the editor is closed
+    // and the queue fills up, further events are simply dropped.
+    mNoteEvents.push({note1, note2});
 
     mNewNoteReceived = false;
 
@@ -739,71 +1399,92 @@ void AmenBreakChopperAudioProcessor::processBlock(
     mWaveformDirty = true;
 }
 
-  midiMessages.swapWith(
-      processedMidi); // Place our generated notes into the main buffer
+  // Place our generated notes into the main buffer. Copying (rather than
+  // swapping) keeps the reserved storage with us for the next block.
+  midiMessages.addEvents(mProcessedMidi, 0, -1, 0);
 
-  // --- Audio Processing Logic (Sample-by-sample) ---
-  const int delayBufferLength = mDelayBuffer.getNumSamples();
-  auto *delayTimeParam = mValueTreeState.getRawParameterValue("delayTime");
-  const int currentDelayTime = static_cast<int>(delayTimeParam->load());
+  // Hosts may send more samples than prepareToPlay announced. The headroom
+  // covers the excess until the timer has grown the buffer.
+  jassert(bufferLength <= mDelayBuffer.getCapacity() - 4);
+  if (bufferLength > mLargestBlockSize.load()) {
+    mLargestBlockSize.store(bufferLength);
+    mDelayBufferResizePending.store(true);
+  }
 
-  for (int sample = 0; sample < bufferLength; ++sample) {
-    if (inputEnabled) {
-      // Input L
-      if (inputChanL < totalNumInputChannels) {
-         float inputVal = buffer.getReadPointer(inputChanL)[sample];
-         mDelayBuffer.getWritePointer(0)[(mWritePosition + sample) % delayBufferLength] = inputVal;
-      }
-      // Input R
-      if (inputChanR < totalNumInputChannels) {
-         float inputVal = buffer.getReadPointer(inputChanR)[sample];
-         mDelayBuffer.getWritePointer(1)[(mWritePosition + sample) % delayBufferLength] = inputVal;
-      }
-    } else {
-        // Silence input to delay buffer if disabled
-        mDelayBuffer.getWritePointer(0)[(mWritePosition + sample) % delayBufferLength] = 0.0f;
-        mDelayBuffer.getWritePointer(1)[(mWritePosition + sample) % delayBufferLength] = 0.0f;
-    }
+  // --- Audio Processing Logic (block write, per-segment read) ---
+  // Record the whole block first. Every delay is at least one eighth note, so
+  // the read side below never reaches samples written later in this block.
+  if (inputEnabled) {
+    if (inputChanL < totalNumInputChannels)
+      writeDelayChannel(0, buffer.getReadPointer(inputChanL), bufferLength);
+    if (inputChanR < totalNumInputChannels)
+      writeDelayChannel(1, buffer.getReadPointer(inputChanR), bufferLength);
+  } else {
+    // Silence input to delay buffer if disabled
+    writeDelayChannel(0, nullptr, bufferLength);
+    writeDelayChannel(1, nullptr, bufferLength);
+  }
+
+  const int numDelayOutputChannels =
+      juce::jmin(2, totalNumOutputChannels); // Only mapped to first 2 outputs
+  const double eighthNoteSamples = (60.0 / bpm) / 2.0 * sampleRate;
+
+  const float chopFadeMs =
+      juce::jlimit(0.0f, kMaxChopFadeMs, mParams.chopFadeMs->load());
+  mChopFadeSamples = static_cast<int>(chopFadeMs * 0.001 * sampleRate);
+  mDelayInterpolation = static_cast<DelayInterpolation>(
+      static_cast<int>(mParams.delayInterpolation->load()));
+
+  for (int segment = 0; segment < mNumDelaySegments; ++segment) {
+    const int segmentStart = mDelaySegments[segment].startSample;
+    const int segmentEnd = (segment + 1 < mNumDelaySegments)
+                               ? mDelaySegments[segment + 1].startSample
+                               : bufferLength;
+    if (segmentEnd <= segmentStart)
+      continue;
 
     // If DelayTime is 0, bypass the effect (output is same as input)
-    if (currentDelayTime != 0 && isPlaying) {
-      double eighthNoteTime = (60.0 / bpm) / 2.0;
-      int delayTimeInSamples =
-          static_cast<int>(eighthNoteTime * currentDelayTime * sampleRate);
-
-      for (int channel = 0; channel < totalNumOutputChannels; ++channel) {
-           if (channel >= 2) break; // Only mapped to first 2 outputs
-
-           const float* delayBufferData = mDelayBuffer.getReadPointer(channel);
-           auto* channelData = buffer.getWritePointer(channel);
-          
-           const int readPosition =
-            (mWritePosition - delayTimeInSamples + sample + delayBufferLength) %
-            delayBufferLength;
-            
-           const float delayedSample = delayBufferData[readPosition];
-           channelData[sample] = delayedSample;
-      }
-    }
+    const int currentDelayTime =
+        isPlaying ? mDelaySegments[segment].delayTime : 0;
+
+    renderDelaySegment(buffer, numDelayOutputChannels, segmentStart,
+                       segmentEnd - segmentStart, currentDelayTime,
+                       eighthNoteSamples);
   }
 
+  renderVoices(buffer, numDelayOutputChannels, bufferLength,
+               ppqAtStartOfBlock, ppqPerSample, eighthNoteSamples, isPlaying);
 
-  mWritePosition = (mWritePosition + bufferLength) % delayBufferLength;
+  const int blockWritePosition = mWritePosition;
+  mWritePosition = mDelayBuffer.wrap(mWritePosition + bufferLength);
   
+  double samplesToNextBeat = 0.0;
   if (positionInfo.getIsPlaying()) {
       // Update samples to next beat for visualization AFTER sequencer update
       // We use the PPQ at the end of the block since mWritePosition is now there.
       double ppqDist = mNextEighthNotePpq - ppqAtEndOfBlock;
       if (ppqPerSample > 0.0) {
-          double samples = ppqDist / ppqPerSample;
-          if (samples < 0) samples = 0; // Safety
-          mSamplesToNextBeat.store(samples);
-      } else {
-          mSamplesToNextBeat.store(0.0);
+          samplesToNextBeat = ppqDist / ppqPerSample;
+          if (samplesToNextBeat < 0) samplesToNextBeat = 0; // Safety
       }
-  } else {
-      mSamplesToNextBeat.store(0.0);
   }
+
+  // Publish the summary and the display timing as one snapshot. The odd
+  // sequence number tells a concurrent reader to retry.
+  const auto sequence = mWaveformSequence.load(std::memory_order_relaxed);
+  mWaveformSequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  mWaveformSummary.update(mDelayBuffer, blockWritePosition, bufferLength);
+  mWaveformTiming.writePosition = mWritePosition;
+  mWaveformTiming.sequencePosition = mSequencePosition.load();
+  mWaveformTiming.samplesToNextBeat = samplesToNextBeat;
+  mWaveformTiming.bpm = bpm;
+  mWaveformTiming.sampleRate = sampleRate;
+
+  mWaveformSequence.store(sequence + 2, std::memory_order_release);
+
+  mSampleCounter += bufferLength;
 }
 
 //==============================================================================
@@ -818,33 +1499,60 @@ juce::AudioProcessorEditor *AmenBreakChopperAudioProcessor::createEditor() {
 //==============================================================================
 void AmenBreakChopperAudioProcessor::oscMessageReceived(
     const juce::OSCMessage &message) {
-  if (message.getAddressPattern() == "/delayTime") {
-    if (message.size() > 0 && message[0].isInt32()) {
-      int newDelayTime = message[0].getInt32();
-      if (newDelayTime >= 0 && newDelayTime <= 15) {
-        auto *delayTimeParam = mValueTreeState.getParameter("delayTime");
-        if (delayTimeParam != nullptr)
-          delayTimeParam->setValueNotifyingHost(
-              static_cast<float>(newDelayTime) / 15.0f);
-      }
-    }
-  } else if (message.getAddressPattern() == "/sequenceReset") {
+  // Receiver thread: decode only. Never blocks, and drops (and counts) the
+  // command if the audio thread has fallen behind.
+  OscSenderThread::Message command{};
+  if (!OscSenderThread::parseAddress(message.getAddressPattern().toString(),
+                                     command.address))
+    return;
+
+  if (message.size() > 0 && message[0].isInt32()) {
+    command.hasValue = true;
+    command.value = message[0].getInt32();
+  }
+
+  if (!mOscCommandQueue.push(command))
+    mNumDroppedOscCommands.fetch_add(1);
+}
+
+// Audio thread, for both transports
+void AmenBreakChopperAudioProcessor::handleRemoteMessage(
+    const OscSenderThread::Message &message) {
+  using Address = OscSenderThread::Address;
+  switch (message.address) {
+  case Address::delayTime:
+    if (message.hasValue && message.value >= 0 && message.value <= 15)
+      mExternalDelayTime.store(message.value); // Published by the timer
+    break;
+  case Address::sequenceReset:
     mSequenceResetQueued = true;
-  } else if (message.getAddressPattern() == "/hardReset") {
+    break;
+  case Address::hardReset:
     mHardResetQueued = true;
-  } else if (message.getAddressPattern() == "/softReset") {
+    break;
+  case Address::softReset:
     mSoftResetQueued = true;
-
-  } else if (message.getAddressPattern() == "/setNoteSequencePosition") {
-    if (message.size() > 0 && message[0].isInt32()) {
-      int noteNumber = message[0].getInt32();
-      if (noteNumber >= 0 && noteNumber <= 15) {
-        mLastReceivedNoteValue = noteNumber;
-        mNoteSequencePosition =
-            noteNumber; // OSC note overrides the note sequence
-        mNewNoteReceived = true;
-      }
+    break;
+  case Address::setNoteSequencePosition:
+    if (message.hasValue && message.value >= 0 && message.value <= 15) {
+      mLastReceivedNoteValue = message.value;
+      mNoteSequencePosition = message.value; // Overrides the note sequence
+      mNewNoteReceived = true;
     }
+    break;
+  default: // Only sent by the Chopper
+    break;
+  }
+}
+
+void AmenBreakChopperAudioProcessor::oscBundleReceived(
+    const juce::OSCBundle &bundle) {
+  // The Controller can send each block's messages as one bundle
+  for (const auto &element : bundle) {
+    if (element.isMessage())
+      oscMessageReceived(element.getMessage());
+    else if (element.isBundle())
+      oscBundleReceived(element.getBundle());
   }
 }
 
@@ -8,50 +8,117 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <limits>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_osc/juce_osc.h>
 
+#include "../../Shared/OscSenderThread.h"
+#include "../../Shared/RealtimeGuard.h"
+#include "../../Shared/RingBuffer.h"
+#include "../../Shared/SpscQueue.h"
+#include "WaveformSummary.h"
+
+// Follows an external 24-ppq MIDI clock with a second-order delay-locked
+// loop. Ticks are timestamped in samples (block start + MidiBuffer offset),
+// the loop filters the tick period, and the musical position is anchored to
+// the tick count so it cannot drift. Fixed size, no allocation.
 struct MidiClockTracker {
-  double lastClockTime{0.0};
+  static constexpr int kTicksPerQuarter = 24;
+
   double detectedBpm{120.0};
-  int clockCount{0};
-  std::vector<double> clockIntervals;
+
+  void prepare(double newSampleRate) {
+    sampleRate = newSampleRate;
+    reset();
+  }
 
   void reset() {
-    lastClockTime = 0.0;
-    clockCount = 0;
-    clockIntervals.clear();
+    tickCount = 0;
+    lastTickTime = 0.0;
+    nextTickTime = 0.0;
+    tickPeriod = getPeriodForBpm(detectedBpm);
   }
 
-  void processClockMessage(double time) {
-    if (lastClockTime > 0.0) {
-      double interval = time - lastClockTime;
-      if (interval > 0.0) {
-        clockIntervals.push_back(interval);
-        if (clockIntervals.size() > 24) { // Average over 24 clocks (1 beat)
-          clockIntervals.erase(clockIntervals.begin());
-        }
-
-        // Issue #26: Update BPM only on 8th note ticks (every 12 clocks)
-        // This reduces jitter in waveform/position display
-        // Issue #26: Update BPM only on 8th note ticks (every 12 clocks)
-        // This reduces jitter in waveform/position display
-        if (clockIntervals.size() >= 4 && (clockCount % 12 == 0)) {
-          double sum = 0.0;
-          for (double i : clockIntervals)
-            sum += i;
-          double avgInterval = sum / clockIntervals.size();
-          // MIDI Clock is 24 ppq. BPM = 60 / (24 * interval)
-          if (avgInterval > 0.001) {
-            detectedBpm = 60.0 / (24.0 * avgInterval);
-          }
-        }
+  // MIDI Start: the next tick is position 0
+  void start() { tickCount = 0; }
+
+  // Loop bandwidth in Hz. Lower values reject more jitter, higher values
+  // follow tempo changes faster.
+  void setBandwidth(double bandwidthHz) { bandwidth = bandwidthHz; }
+
+  void processClockMessage(juce::int64 sampleTime) {
+    const double time = static_cast<double>(sampleTime);
+
+    if (tickCount == 0) {
+      // First tick after a reset: predict the next one from the last tempo
+      nextTickTime = time + tickPeriod;
+      lastTickTime = time;
+      seedPeriod = true;
+    } else if (seedPeriod) {
+      // Seed the period from the first measured interval
+      const double interval = time - lastTickTime;
+      if (interval > 0.0)
+        tickPeriod = interval;
+      nextTickTime = time + tickPeriod;
+      lastTickTime = time;
+      seedPeriod = false;
+    } else {
+      const double error = time - nextTickTime;
+      if (std::abs(error) > kMaxErrorInPeriods * tickPeriod) {
+        // Clock paused (Continue), dropped out or jumped. Relock the phase
+        // here and re-measure the period, but keep counting ticks: the
+        // position carries on from the last tick instead of restarting at 0
+        // behind the sequencer.
+        nextTickTime = time + tickPeriod;
+        lastTickTime = time;
+        seedPeriod = true;
+      } else {
+        // Loop gain per tick, capped so slow tempos stay stable
+        const double omega = juce::jmin(
+            kMaxOmega, juce::MathConstants<double>::twoPi * bandwidth *
+                           tickPeriod / sampleRate);
+        const double b = juce::MathConstants<double>::sqrt2 * omega;
+        const double c = omega * omega;
+        nextTickTime += tickPeriod + b * error;
+        tickPeriod += c * error;
+        lastTickTime = nextTickTime - tickPeriod; // Filtered time of this tick
       }
     }
-    lastClockTime = time;
-    clockCount++;
+    ++tickCount;
+
+    if (tickPeriod > 0.0)
+      detectedBpm = 60.0 * sampleRate / (kTicksPerQuarter * tickPeriod);
+  }
+
+  bool isLocked() const { return tickCount > 0; }
+
+  // PPQ position at an absolute sample time, extrapolated from the last tick
+  // but never past the next one, so a stopped clock freezes the phase. Only
+  // meaningful while isLocked().
+  double getPpqAt(juce::int64 sampleTime) const {
+    const double sinceTick =
+        (static_cast<double>(sampleTime) - lastTickTime) / tickPeriod;
+    return (static_cast<double>(tickCount - 1) + juce::jmin(1.0, sinceTick)) /
+           kTicksPerQuarter;
+  }
+
+private:
+  static constexpr double kMaxErrorInPeriods = 4.0;
+  static constexpr double kMaxOmega = 0.5;
+
+  double getPeriodForBpm(double bpm) const {
+    return 60.0 * sampleRate / (kTicksPerQuarter * bpm);
   }
+
+  double sampleRate{44100.0};
+  double bandwidth{1.0};
+  juce::int64 tickCount{0};
+  bool seedPeriod{false}; // The next interval re-measures tickPeriod
+  double lastTickTime{0.0};
+  double nextTickTime{0.0};
+  double tickPeriod{0.0};
 };
 
 //==============================================================================
@@ -59,9 +126,9 @@ struct MidiClockTracker {
  */
 class AmenBreakChopperAudioProcessor
     : public juce::AudioProcessor,
-      private juce::OSCReceiver::Listener<
-          juce::OSCReceiver::MessageLoopCallback>,
-      public juce::AudioProcessorValueTreeState::Listener {
+      private juce::OSCReceiver::Listener<juce::OSCReceiver::RealtimeCallback>,
+      public juce::AudioProcessorValueTreeState::Listener,
+      private juce::Timer {
 public:
   //==============================================================================
   AmenBreakChopperAudioProcessor();
@@ -103,8 +170,20 @@ public:
   juce::AudioProcessorValueTreeState &getValueTreeState();
   void setOscHostAddress(const juce::String &hostAddress);
 
-  // Callbacks for UI
-  std::function<void(int, int)> onNoteEvent;
+  // For the offline tools (--render, --scenario, --bench). A headless
+  // processor opens no OSC sockets or shared memory queue and sends
+  // nothing, so parallel runs neither fight over ports nor talk to a live
+  // Controller. Set before prepareToPlay.
+  void setHeadless(bool shouldBeHeadless) { mHeadless = shouldBeHeadless; }
+
+  // Note/tick events for the UI. The audio thread pushes into a preallocated
+  // queue and the editor drains it from its timer, so no message is posted
+  // from the realtime thread.
+  struct NoteEvent {
+    int note1; // 0-15 (Seq)
+    int note2; // 32-47 (Original), -1 for Input/Trigger
+  };
+  bool popNoteEvent(NoteEvent &event) { return mNoteEvents.pop(event); }
 
   // Reset Commands
   void performSequenceReset();
@@ -113,7 +192,15 @@ public:
   void triggerNoteFromUi(int noteNumber);
   
   // Waveform Data
-  std::vector<float> getWaveformData();
+  // One frame holds 16 steps x 32 bins of (min, max) pairs, quantised to int8
+  // so the editor can hand it to the WebView as a compact binary payload.
+  static constexpr int kWaveformSteps = 16;
+  static constexpr int kWaveformBins = 32;
+  using WaveformFrame =
+      std::array<juce::int8, kWaveformSteps * kWaveformBins * 2>;
+  // Fills a frame from a consistent snapshot of the audio thread's state.
+  // Returns false if the audio thread kept publishing; try again later.
+  bool getWaveformFrame(WaveformFrame &frame, int &sequencePosition);
   int getSequencePosition() { return mSequencePosition.load(); }
   std::atomic<bool> mWaveformDirty{true};
 
@@ -125,11 +212,205 @@ private:
   createParameterLayout();
   juce::AudioProcessorValueTreeState mValueTreeState;
 
-  juce::AudioBuffer<float> mDelayBuffer;
+  // Parameter pointers resolved once in the constructor, so the hot paths
+  // never look parameters up by string ID.
+  struct CachedParameters {
+    std::atomic<float> *bpmSyncMode{nullptr};
+    std::atomic<float> *inputEnabled{nullptr};
+    std::atomic<float> *inputChanL{nullptr};
+    std::atomic<float> *inputChanR{nullptr};
+    std::atomic<float> *delayTimeValue{nullptr};
+    std::atomic<float> *midiInputChannel{nullptr};
+    std::atomic<float> *midiOutputChannel{nullptr};
+    std::atomic<float> *midiCcSeqReset{nullptr};
+    std::atomic<float> *midiCcSeqResetMode{nullptr};
+    std::atomic<float> *midiCcHardReset{nullptr};
+    std::atomic<float> *midiCcHardResetMode{nullptr};
+    std::atomic<float> *midiCcSoftReset{nullptr};
+    std::atomic<float> *midiCcSoftResetMode{nullptr};
+    std::atomic<float> *midiCcDelayAdjustFwd{nullptr};
+    std::atomic<float> *midiCcDelayAdjustBwd{nullptr};
+    std::atomic<float> *chopFadeMs{nullptr};
+    std::atomic<float> *delayInterpolation{nullptr};
+    std::atomic<float> *oscBundling{nullptr};
+    std::atomic<float> *oscTimeTags{nullptr};
+    std::atomic<float> *midiClockBandwidth{nullptr};
+    std::atomic<float> *minTempo{nullptr};
+    std::atomic<float> *voiceCount{nullptr};
+    std::atomic<float> *voiceLength{nullptr};
+    std::atomic<float> *voiceLevel{nullptr};
+
+    juce::RangedAudioParameter *delayTime{nullptr};
+    juce::RangedAudioParameter *sequencePosition{nullptr};
+    juce::RangedAudioParameter *noteSequencePosition{nullptr};
+    juce::AudioParameterInt *delayAdjust{nullptr};
+    juce::AudioParameterInt *delayAdjustCcStep{nullptr};
+  };
+  CachedParameters mParams;
+
+  void cacheParameters();
+  static juce::int8 quantiseWaveformSample(float sample);
+
+  // --- Parameter publication ---
+  // The audio thread owns the sequencer state and only writes these atomics.
+  // A message-thread timer coalesces them into setValueNotifyingHost calls,
+  // so host listeners never run on the realtime thread. Changes that arrive
+  // from the host, UI or OSC are handed back through mExternalDelayTime.
+  static constexpr int kParameterPublishHz = 60;
+  int mDelayTimeState{0}; // Audio thread
+  std::atomic<int> mPublishedDelayTime{0};
+  std::atomic<int> mPublishedNoteSequencePosition{0};
+  std::atomic<int> mExternalDelayTime{-1};
+  std::atomic<int> mDelayTimeEcho{-1}; // Value being published, else -1
+  // Same hand-off for the delayAdjust CCs. Negative values are valid here.
+  static constexpr int kNoDelayAdjust = std::numeric_limits<int>::min();
+  int mDelayAdjustState{0}; // Audio thread
+  std::atomic<int> mPublishedDelayAdjust{0};
+  std::atomic<int> mExternalDelayAdjust{kNoDelayAdjust};
+  std::atomic<int> mDelayAdjustEcho{kNoDelayAdjust};
+
+  void setDelayTimeState(int newDelayTime);
+  void setDelayAdjustState(int newDelayAdjust);
+  void publishParameter(juce::RangedAudioParameter *parameter, int value);
+  void timerCallback() override;
+
+  // --- Delay buffer ---
+  // Sized for 16 eighth notes at the minTempo floor plus the largest
+  // delayAdjust and one block, rounded up to a power of two so positions wrap
+  // with a mask. A new floor, or a block longer than the host announced, is
+  // applied by the message-thread timer with processing suspended. Until
+  // then the fixed headroom keeps long reads clear of the block being
+  // written.
+  RingBuffer<float> mDelayBuffer;
+  WaveformSummary mWaveformSummary; // Follows every write to mDelayBuffer
+  double mMaxDelayInSamples{0.0}; // Longest read that is still recorded
   int mWritePosition{0};
   double mSampleRate{0.0};
-  std::atomic<double> mCurrentBpm{120.0};
-  std::atomic<double> mSamplesToNextBeat{0.0};
+  int mMaxBlockSize{0};
+  static constexpr int kBlockHeadroom = 4096;
+  std::atomic<int> mLargestBlockSize{0}; // Seen by the audio thread
+  int mDelayBlockMargin{0}; // Samples kept beyond mMaxDelayInSamples
+  std::atomic<bool> mDelayBufferResizePending{false};
+
+  int getDelayBlockMargin() const;
+  int getRequiredDelayBufferSize() const;
+  void allocateDelayBuffer(int size);
+
+  // --- Waveform snapshot ---
+  // processBlock publishes the summary and the timing the display needs under
+  // a seqlock, so it never waits for the UI. mWaveformLock is only taken by
+  // prepareToPlay/releaseResources and the reader, to keep the storage alive.
+  struct WaveformTiming {
+    int writePosition{0};
+    int sequencePosition{0};
+    double samplesToNextBeat{0.0};
+    double bpm{120.0};
+    double sampleRate{0.0};
+  };
+  static constexpr int kMaxWaveformSnapshotAttempts = 8;
+  WaveformTiming mWaveformTiming;
+  std::atomic<juce::uint32> mWaveformSequence{0};
+  CheckedCriticalSection mWaveformLock;
+
+  void fillWaveformFrame(WaveformFrame &frame,
+                         const WaveformTiming &timing) const;
+
+  // --- Sample-accurate delay segments ---
+  // The tick loop records where inside the block the delay time changes, so
+  // the audio loop can switch read positions on the exact tick sample.
+  struct DelaySegment {
+    int startSample;
+    int delayTime;
+  };
+  static constexpr int kMaxDelaySegments = 64;
+  std::array<DelaySegment, kMaxDelaySegments> mDelaySegments;
+  int mNumDelaySegments{0};
+
+  void addDelaySegment(int startSample, int delayTime);
+
+  // --- Delay line kernel ---
+  // All helpers work on the (at most two) contiguous spans mDelayBuffer hands
+  // out around its wrap point. A null source records silence.
+  //
+  // Delays are fractional. Within one segment the fractional part is
+  // constant, so interpolation reduces to a fixed 2- or 4-tap filter that is
+  // applied as whole-run vector multiply-adds.
+  enum class DelayInterpolation { none = 0, linear, hermite };
+  DelayInterpolation mDelayInterpolation{DelayInterpolation::linear};
+
+  void writeDelayChannel(int channel, const float *source, int numSamples);
+  void readDelayChannel(int channel, float *dest, int startSample,
+                        int numSamples, double delayInSamples) const;
+  void readDelayTap(int channel, float *dest, int position, int numSamples,
+                    float gain, bool accumulate) const;
+
+  // --- Chop crossfade ---
+  // When the delay time changes, the previous read head keeps running and is
+  // faded out against the new one with equal-power tables, so the second read
+  // only costs anything while a fade is in progress. Delay time 0 is the dry
+  // input.
+  static constexpr float kMaxChopFadeMs = 50.0f;
+  int mCurrentDelayTime{0};
+  int mFadeFromDelayTime{0};
+  int mFadePosition{0};
+  int mFadeLength{0};
+  int mChopFadeSamples{0};
+  std::vector<float> mFadeInTable;
+  std::vector<float> mFadeOutTable;
+  int mFadeTableLength{0};
+  juce::AudioBuffer<float> mFadeScratch;
+
+  void updateFadeTables(int lengthInSamples);
+  void renderDelaySegment(juce::AudioBuffer<float> &buffer, int numChannels,
+                          int startSample, int numSamples, int delayTime,
+                          double eighthNoteSamples);
+
+  // --- Slice voices ---
+  // Notes 16-31 start extra read heads on the slice of the same number in the
+  // recorded bar, mixed on top of the chop. Each voice plays voiceLength with
+  // a short attack/release and rolls (restarts the slice) while its note is
+  // held. The pool is fixed; when it is full the oldest voice, preferring
+  // released ones, is stolen. Every voice is one vector read plus one
+  // multiply-add per span, so the cost is linear in the active voices.
+  static constexpr int kMaxVoices = 8;
+  static constexpr int kFirstVoiceNote = 16;
+  static constexpr int kMaxVoiceEvents = 64;
+  // Hermite reads two samples past the whole delay, so anything shorter
+  // would reach past the block just written into stale audio.
+  static constexpr double kMinVoiceDelaySamples = 2.0;
+
+  struct Voice {
+    bool active{false};
+    bool held{false}; // Note still down: roll instead of ending
+    int slice{0};
+    double delayInSamples{0.0};
+    int cycleLength{0}; // Samples per (repeated) slice
+    int cyclePosition{0};
+    double barLength{0.0}; // 16 steps, to re-anchor a roll on the newest bar
+    int rampLength{0};
+    float gain{0.0f};
+    juce::uint32 startOrder{0}; // For stealing the oldest
+  };
+  struct VoiceEvent {
+    int sample;
+    int slice;
+    float gain; // 0 for note off
+  };
+
+  std::array<Voice, kMaxVoices> mVoices;
+  std::array<VoiceEvent, kMaxVoiceEvents> mVoiceEvents;
+  int mNumVoiceEvents{0};
+  juce::uint32 mVoiceStartCounter{0};
+  juce::AudioBuffer<float> mVoiceScratch;
+
+  void startVoice(const VoiceEvent &event, double delayInSamples,
+                  int cycleLength, double barLength);
+  void renderVoices(juce::AudioBuffer<float> &buffer, int numChannels,
+                    int numSamples, double ppqAtStartOfBlock,
+                    double ppqPerSample, double eighthNoteSamples,
+                    bool isPlaying);
+  void renderVoice(Voice &voice, juce::AudioBuffer<float> &buffer,
+                   int numChannels, int startSample, int numSamples);
 
   // --- Sequencer State ---
   double mNextEighthNotePpq{0.0};
@@ -144,6 +425,16 @@ private:
   int mLastNote1{-1};
   int mLastNote2{-1};
 
+  // --- MIDI Output ---
+  // Generated notes are collected here; the capacity is reserved up front so
+  // the audio thread does not grow it in normal use (up to four events per
+  // tick plus the reset note-offs).
+  static constexpr int kMidiOutputReserveBytes = 4096;
+  juce::MidiBuffer mProcessedMidi;
+
+  // --- UI Event Queue ---
+  SpscQueue<NoteEvent, 256> mNoteEvents;
+
   // --- CC Value State ---
   int mLastSeqResetCcValue{0};
   int mLastHardResetCcValue{0};
@@ -155,13 +446,37 @@ private:
   // --- External Input & Clock State ---
   MidiClockTracker mMidiClockTracker;
   std::atomic<bool> mUsingMidiClock{false};
-  double mMidiClockPpq{0.0}; // Synthesized phase from MIDI clock ticks
+  double mMidiClockPpq{0.0}; // Free-running phase until the clock locks
+  bool mMidiClockWasLocked{false}; // Lock state at the previous block
+  juce::int64 mSampleCounter{0}; // Absolute sample time of the block start
 
   // --- OSC State ---
-  juce::OSCSender mSender;
-  juce::OSCReceiver mReceiver;
+  OscSenderThread mOscSender{"AmenBreakChopper OSC Sender"};
+  bool mHeadless{false};
+  juce::uint32 mOscTick{0};  // Groups each tick's messages for bundling
+  juce::uint32 mOscBlock{0}; // Same per processBlock call, for coalescing
+
+  // Incoming commands skip the message thread: the receiver's own thread
+  // decodes them into mOscCommandQueue, and processBlock drains it (and the
+  // shared memory queue) before anything else. /delayTime then takes effect
+  // at sample 0 of that block; resets and /setNoteSequencePosition at its
+  // first tick, exactly like their MIDI counterparts.
+  static constexpr int kOscCommandQueueCapacity = 256;
+  SpscQueue<OscSenderThread::Message, kOscCommandQueueCapacity>
+      mOscCommandQueue;
+  std::atomic<int> mNumDroppedOscCommands{0};
+
+  // Same-host transport. The audio thread only try-locks, so reopening the
+  // queue never blocks the callback.
+  CheckedSpinLock mSharedInputLock;
+  OscSenderThread::SharedQueue mSharedInput;
+
+  juce::OSCReceiver mReceiver; // After the queues it feeds
 
+  void updateSharedMemoryTransport();
+  void handleRemoteMessage(const OscSenderThread::Message &message);
   void oscMessageReceived(const juce::OSCMessage &message) override;
+  void oscBundleReceived(const juce::OSCBundle &bundle) override;
 
   bool shouldTriggerReset(int mode, int previousValue, int currentValue);
 
@@ -0,0 +1,269 @@
+/*
+  ==============================================================================
+
+    ProcessorBenchmark.cpp
+    Part of AmenBreakChopper
+
+  ==============================================================================
+*/
+
+#include "ProcessorBenchmark.h"
+#include "OfflineRenderer.h"
+#include "PluginProcessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+const double kSampleRates[] = {44100.0, 48000.0, 96000.0, 192000.0};
+const int kBlockSizes[] = {32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+const char *getMidiLoadName(ProcessorBenchmark::MidiLoad midiLoad) {
+  return midiLoad == ProcessorBenchmark::MidiLoad::dense ? "dense" : "sparse";
+}
+
+double ticksToMicroseconds(juce::int64 ticks) {
+  return juce::Time::highResolutionTicksToSeconds(ticks) * 1.0e6;
+}
+} // namespace
+
+//==============================================================================
+bool ProcessorBenchmark::isBenchCommandLine(const juce::StringArray &args) {
+  return args.contains("--bench");
+}
+
+juce::String ProcessorBenchmark::parseCommandLine(const juce::StringArray &args,
+                                                  Options &options) {
+  auto getValue = [&args](const juce::String &name) -> juce::String {
+    const int index = args.indexOf(name);
+    return (index >= 0 && index + 1 < args.size()) ? args[index + 1]
+                                                   : juce::String();
+  };
+
+  const auto seconds = getValue("--seconds");
+  if (seconds.isNotEmpty())
+    options.seconds = seconds.getDoubleValue();
+  if (options.seconds <= 0.0 || options.seconds > 600.0)
+    return "Invalid --seconds: " + seconds;
+
+  const auto bpm = getValue("--bpm");
+  if (bpm.isNotEmpty())
+    options.bpm = bpm.getDoubleValue();
+  if (options.bpm < 20.0 || options.bpm > 999.0)
+    return "Invalid --bpm: " + bpm;
+
+  const auto csvPath = getValue("--csv");
+  if (csvPath.isNotEmpty())
+    options.csvFile =
+        juce::File::getCurrentWorkingDirectory().getChildFile(
+            csvPath.unquoted());
+
+  return {};
+}
+
+//==============================================================================
+juce::String ProcessorBenchmark::run(const Options &options) {
+  // Count every allocation instead of stopping at the first one
+  RealtimeGuard::setAssertOnViolation(false);
+
+  juce::String csv =
+      "sample_rate,block_size,midi,ns_per_sample,p99_block_us,p99_block_load,"
+      "allocations_per_block,waveform_frame_us\n";
+
+  printf("%8s %6s %7s %10s %12s %9s %13s %12s\n", "rate", "block", "midi",
+         "ns/sample", "p99 block us", "p99 load", "allocs/block",
+         "waveform us");
+
+  for (const double sampleRate : kSampleRates) {
+    for (const int blockSize : kBlockSizes) {
+      for (const auto midiLoad : {MidiLoad::sparse, MidiLoad::dense}) {
+        const auto result =
+            runConfiguration(options, sampleRate, blockSize, midiLoad);
+        printf("%s\n", formatRow(result).toRawUTF8());
+        fflush(stdout);
+        csv << formatCsvRow(result) << "\n";
+      }
+    }
+  }
+
+  RealtimeGuard::setAssertOnViolation(true);
+
+  if (options.csvFile != juce::File() &&
+      !options.csvFile.replaceWithText(csv))
+    return "Cannot write CSV file: " + options.csvFile.getFullPathName();
+  return {};
+}
+
+//==============================================================================
+ProcessorBenchmark::Result
+ProcessorBenchmark::runConfiguration(const Options &options, double sampleRate,
+                                     int blockSize, MidiLoad midiLoad) {
+  AmenBreakChopperAudioProcessor processor;
+  OfflineRenderer::FixedTempoPlayHead playHead(options.bpm, sampleRate);
+  processor.setPlayHead(&playHead);
+  processor.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+  processor.setHeadless(true); // No sender thread or UDP in the numbers
+  OfflineRenderer::configureForHeadless(processor);
+  processor.prepareToPlay(sampleRate, blockSize);
+
+  // One second of warm-up lets the delay buffer, fade tables and MIDI
+  // buffers settle before anything is measured.
+  const int numWarmupBlocks =
+      juce::jmax(1, static_cast<int>(sampleRate / blockSize));
+  const int numMeasuredBlocks = juce::jmax(
+      1, static_cast<int>(options.seconds * sampleRate / blockSize));
+  const double samplesPerBeat = sampleRate * 60.0 / options.bpm;
+  const double samplesPerWaveformFrame = sampleRate / kWaveformFrameHz;
+
+  // Low-level noise, so the waveform summary sees real data
+  juce::AudioBuffer<float> source(2, blockSize);
+  juce::Random random(0x414d454e);
+  for (int channel = 0; channel < 2; ++channel)
+    for (int i = 0; i < blockSize; ++i)
+      source.setSample(channel, i, (random.nextFloat() * 2.0f - 1.0f) * 0.25f);
+
+  juce::AudioBuffer<float> block(2, blockSize);
+  juce::MidiBuffer midi;
+  midi.ensureSize(4096);
+
+  std::vector<juce::int64> blockTicks;
+  blockTicks.reserve((size_t)numMeasuredBlocks);
+  juce::int64 totalTicks = 0;
+  juce::int64 waveformTicks = 0;
+  int numWaveformFrames = 0;
+  double nextWaveformFrame = 0.0;
+  AmenBreakChopperAudioProcessor::WaveformFrame frame;
+  int sequencePosition = 0;
+  juce::int64 allocationsAtStart = 0;
+
+  juce::int64 start = 0;
+  for (int blockIndex = 0; blockIndex < numWarmupBlocks + numMeasuredBlocks;
+       ++blockIndex, start += blockSize) {
+    const bool measuring = blockIndex >= numWarmupBlocks;
+    if (blockIndex == numWarmupBlocks)
+      allocationsAtStart = RealtimeGuard::getNumAllocations();
+
+    for (int channel = 0; channel < 2; ++channel)
+      block.copyFrom(channel, 0, source, channel, 0, blockSize);
+    midi.clear();
+    fillMidi(midiLoad, samplesPerBeat, start, blockSize, midi);
+    playHead.setTimeInSamples(start);
+
+    const auto blockStart = juce::Time::getHighResolutionTicks();
+    processor.processBlock(block, midi);
+    const auto elapsed = juce::Time::getHighResolutionTicks() - blockStart;
+
+    if (!measuring)
+      continue;
+    blockTicks.push_back(elapsed);
+    totalTicks += elapsed;
+
+    // The editor's pull, as often as its timer would fire
+    if ((double)start >= nextWaveformFrame) {
+      nextWaveformFrame += samplesPerWaveformFrame;
+      const auto frameStart = juce::Time::getHighResolutionTicks();
+      processor.getWaveformFrame(frame, sequencePosition);
+      waveformTicks += juce::Time::getHighResolutionTicks() - frameStart;
+      ++numWaveformFrames;
+    }
+  }
+
+  const auto numAllocations =
+      RealtimeGuard::getNumAllocations() - allocationsAtStart;
+  processor.releaseResources();
+  processor.setPlayHead(nullptr);
+
+  const size_t p99Index = juce::jmin(
+      blockTicks.size() - 1, (size_t)(0.99 * (double)blockTicks.size()));
+  std::nth_element(blockTicks.begin(), blockTicks.begin() + (long)p99Index,
+                   blockTicks.end());
+
+  Result result;
+  result.sampleRate = sampleRate;
+  result.blockSize = blockSize;
+  result.midiLoad = midiLoad;
+  result.nsPerSample = ticksToMicroseconds(totalTicks) * 1000.0 /
+                       ((double)numMeasuredBlocks * blockSize);
+  result.p99BlockMicroseconds = ticksToMicroseconds(blockTicks[p99Index]);
+  result.p99BlockLoad =
+      result.p99BlockMicroseconds / (blockSize / sampleRate * 1.0e6);
+  result.allocationsPerBlock =
+      (double)numAllocations / (double)numMeasuredBlocks;
+  result.waveformFrameMicroseconds =
+      numWaveformFrames > 0
+          ? ticksToMicroseconds(waveformTicks) / numWaveformFrames
+          : 0.0;
+  return result;
+}
+
+void ProcessorBenchmark::fillMidi(MidiLoad midiLoad, double samplesPerBeat,
+                                  juce::int64 start, int numSamples,
+                                  juce::MidiBuffer &midi) {
+  const juce::int64 end = start + numSamples;
+
+  // Chops: notes 0-15 in turn, each cutting the previous one off
+  const double notePeriod =
+      midiLoad == MidiLoad::dense ? samplesPerBeat / 4.0 : samplesPerBeat;
+  for (auto k = (juce::int64)std::ceil((double)start / notePeriod);; ++k) {
+    const auto time = (juce::int64)(k * notePeriod);
+    if (time >= end)
+      break;
+    const int position = (int)(time - start);
+    if (k > 0)
+      midi.addEvent(juce::MidiMessage::noteOff(1, (int)((k - 1) % 16)),
+                    position);
+    midi.addEvent(juce::MidiMessage::noteOn(1, (int)(k % 16), (juce::uint8)100),
+                  position);
+  }
+
+  if (midiLoad != MidiLoad::dense)
+    return;
+
+  // Controller stream: delay adjust fwd/bwd presses (CC 21/19) plus a mod
+  // wheel sweep that the processor has to inspect and ignore.
+  for (auto time = (start + kDenseCcInterval - 1) / kDenseCcInterval *
+                   kDenseCcInterval;
+       time < end; time += kDenseCcInterval) {
+    const auto k = time / kDenseCcInterval;
+    const int position = (int)(time - start);
+    midi.addEvent(juce::MidiMessage::controllerEvent(1, 1, (int)(k % 128)),
+                  position);
+    if (k % 64 == 0)
+      midi.addEvent(juce::MidiMessage::controllerEvent(
+                        1, (k / 64) % 2 == 0 ? 21 : 19, 127),
+                    position);
+    else if (k % 64 == 1)
+      midi.addEvent(juce::MidiMessage::controllerEvent(
+                        1, (k / 64) % 2 == 0 ? 21 : 19, 0),
+                    position);
+  }
+}
+
+//==============================================================================
+juce::String ProcessorBenchmark::formatRow(const Result &result) {
+  const juce::String allocations =
+      AMENBREAK_REALTIME_GUARD ? juce::String(result.allocationsPerBlock, 2)
+                               : juce::String("n/a");
+  char row[160];
+  snprintf(row, sizeof(row), "%8.0f %6d %7s %10.2f %12.2f %9.4f %13s %12.2f",
+           result.sampleRate, result.blockSize,
+           getMidiLoadName(result.midiLoad), result.nsPerSample,
+           result.p99BlockMicroseconds, result.p99BlockLoad,
+           allocations.toRawUTF8(), result.waveformFrameMicroseconds);
+  return row;
+}
+
+juce::String ProcessorBenchmark::formatCsvRow(const Result &result) {
+  return juce::String(result.sampleRate, 0) + "," +
+         juce::String(result.blockSize) + "," +
+         getMidiLoadName(result.midiLoad) + "," +
+         juce::String(result.nsPerSample, 3) + "," +
+         juce::String(result.p99BlockMicroseconds, 3) + "," +
+         juce::String(result.p99BlockLoad, 5) + "," +
+         (AMENBREAK_REALTIME_GUARD
+              ? juce::String(result.allocationsPerBlock, 3)
+              : juce::String()) +
+         "," + juce::String(result.waveformFrameMicroseconds, 3);
+}
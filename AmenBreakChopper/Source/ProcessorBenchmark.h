@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    ProcessorBenchmark.h
+    Part of AmenBreakChopper
+
+    Headless benchmark mode of the Standalone app. Runs
+    AmenBreakChopperAudioProcessor::processBlock over every combination of
+    buffer size (32-4096), sample rate (44.1-192 kHz) and MIDI load (sparse:
+    one chop per beat; dense: a chop per 16th plus a CC stream), and prints
+    ns/sample, the p99 block time, allocations per block and the cost of
+    getWaveformFrame() at the editor's 30 Hz.
+
+      ABC --bench [--seconds 5] [--bpm 174] [--csv results.csv]
+
+    Allocations are only counted when RealtimeGuard is compiled in (debug
+    builds, or AMENBREAK_REALTIME_GUARD=1); timings are only meaningful in
+    release builds, so compare like with like across commits.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+class ProcessorBenchmark {
+public:
+  struct Options {
+    double seconds{5.0}; // Measured audio per configuration
+    double bpm{174.0};
+    juce::File csvFile; // Optional
+  };
+
+  enum class MidiLoad { sparse = 0, dense };
+
+  struct Result {
+    double sampleRate{0.0};
+    int blockSize{0};
+    MidiLoad midiLoad{MidiLoad::sparse};
+    double nsPerSample{0.0};
+    double p99BlockMicroseconds{0.0};
+    double p99BlockLoad{0.0}; // p99 block time / block duration
+    double allocationsPerBlock{0.0};
+    double waveformFrameMicroseconds{0.0};
+  };
+
+  static bool isBenchCommandLine(const juce::StringArray &args);
+
+  // Parses the --bench arguments. Returns an error message, or an empty
+  // string on success.
+  static juce::String parseCommandLine(const juce::StringArray &args,
+                                       Options &options);
+
+  // Runs every configuration, printing a row per result. Returns an error
+  // message, or an empty string on success.
+  static juce::String run(const Options &options);
+
+private:
+  static Result runConfiguration(const Options &options, double sampleRate,
+                                 int blockSize, MidiLoad midiLoad);
+  static void fillMidi(MidiLoad midiLoad, double samplesPerBeat,
+                       juce::int64 start, int numSamples,
+                       juce::MidiBuffer &midi);
+  static juce::String formatRow(const Result &result);
+  static juce::String formatCsvRow(const Result &result);
+
+  static constexpr double kWaveformFrameHz = 30.0; // PluginEditor's timer
+  static constexpr int kDenseCcInterval = 32;      // Samples between CCs
+};
@@ -0,0 +1,356 @@
+/*
+  ==============================================================================
+
+    ScenarioRunner.cpp
+    Part of AmenBreakChopper
+
+  ==============================================================================
+*/
+
+#include "ScenarioRunner.h"
+#include "OfflineRenderer.h"
+#include "PluginProcessor.h"
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+//==============================================================================
+// Host transport driven by the script: plays, stops, jumps and loops at block
+// boundaries, the way most hosts do.
+class ScenarioRunner::ScenarioPlayHead : public juce::AudioPlayHead {
+public:
+  double bpm{120.0};
+  double sampleRate{44100.0};
+  double ppq{0.0};
+  bool playing{false};
+  bool looping{false};
+  double loopStart{0.0};
+  double loopEnd{0.0};
+  juce::int64 timeInSamples{0};
+
+  void advance(int numSamples) {
+    timeInSamples += numSamples;
+    if (!playing)
+      return;
+    ppq += numSamples * bpm / (60.0 * sampleRate);
+    if (looping && loopEnd > loopStart && ppq >= loopEnd)
+      ppq = loopStart + std::fmod(ppq - loopEnd, loopEnd - loopStart);
+  }
+
+  juce::Optional<PositionInfo> getPosition() const override {
+    PositionInfo info;
+    info.setBpm(bpm);
+    info.setTimeInSamples(timeInSamples);
+    info.setTimeInSeconds(static_cast<double>(timeInSamples) / sampleRate);
+    info.setPpqPosition(ppq);
+    info.setTimeSignature(juce::AudioPlayHead::TimeSignature{});
+    info.setIsPlaying(playing);
+    info.setIsLooping(looping);
+    if (looping)
+      info.setLoopPoints(juce::AudioPlayHead::LoopPoints{loopStart, loopEnd});
+    return info;
+  }
+};
+
+//==============================================================================
+// Run-length trace of the read delay implied by each output sample.
+class ScenarioRunner::AudioTrace {
+public:
+  void add(juce::int64 sampleIndex, float value) {
+    // Input sample n carried n mod kRampPeriod / kRampPeriod, so the output
+    // tells us which input sample it was read from.
+    double delay = std::fmod(static_cast<double>(sampleIndex) -
+                                 static_cast<double>(value) * kRampPeriod,
+                             (double)kRampPeriod);
+    if (delay < -kTolerance)
+      delay += kRampPeriod;
+    if (delay > kRampPeriod - kTolerance)
+      delay -= kRampPeriod;
+
+    if (!mRuns.empty() && std::abs(mRuns.back().delay - delay) <= kTolerance) {
+      ++mRuns.back().length;
+      return;
+    }
+    mRuns.push_back({sampleIndex, delay, 1});
+  }
+
+  void write(juce::StringArray &trace) const {
+    bool inTransition = false;
+    for (const auto &run : mRuns) {
+      if (run.length < kMinStableRun) {
+        if (!inTransition)
+          trace.add("audio " + juce::String(run.start) + " ~");
+        inTransition = true;
+        continue;
+      }
+      inTransition = false;
+      trace.add("audio " + juce::String(run.start) + " " +
+                juce::String(run.delay, 1));
+    }
+  }
+
+private:
+  struct Run {
+    juce::int64 start;
+    double delay;
+    juce::int64 length;
+  };
+
+  static constexpr double kTolerance = 0.05; // Samples
+  static constexpr int kMinStableRun = 8;
+
+  std::vector<Run> mRuns;
+};
+
+//==============================================================================
+bool ScenarioRunner::isScenarioCommandLine(const juce::StringArray &args) {
+  return args.contains("--scenario");
+}
+
+juce::String ScenarioRunner::parseCommandLine(const juce::StringArray &args,
+                                              Options &options) {
+  const int index = args.indexOf("--scenario");
+  if (index < 0 || index + 1 >= args.size())
+    return "Usage: --scenario <file.scenario | directory> [--update-golden]";
+
+  const auto path = juce::File::getCurrentWorkingDirectory().getChildFile(
+      args[index + 1].unquoted());
+  if (path.isDirectory()) {
+    options.scenarioFiles =
+        path.findChildFiles(juce::File::findFiles, false, "*.scenario");
+    options.scenarioFiles.sort();
+  } else if (path.existsAsFile()) {
+    options.scenarioFiles.add(path);
+  }
+
+  if (options.scenarioFiles.isEmpty())
+    return "No scenario files found: " + path.getFullPathName();
+
+  options.updateGolden = args.contains("--update-golden");
+  return {};
+}
+
+//==============================================================================
+juce::String ScenarioRunner::run(const Options &options) {
+  int numFailed = 0;
+
+  for (const auto &file : options.scenarioFiles) {
+    const auto goldenFile = file.withFileExtension(".golden");
+    const auto name = file.getFileName();
+
+    juce::StringArray trace;
+    auto error = runScenario(file, trace);
+
+    if (error.isEmpty() && options.updateGolden) {
+      if (goldenFile.replaceWithText(trace.joinIntoString("\n") + "\n")) {
+        printf("UPDATED %s\n", name.toRawUTF8());
+        continue;
+      }
+      error = "Cannot write " + goldenFile.getFullPathName();
+    }
+
+    if (error.isEmpty())
+      error = compareWithGolden(trace, goldenFile);
+
+    if (error.isEmpty()) {
+      printf("PASS %s\n", name.toRawUTF8());
+    } else {
+      printf("FAIL %s: %s\n", name.toRawUTF8(), error.toRawUTF8());
+      ++numFailed;
+    }
+  }
+
+  if (numFailed > 0)
+    return juce::String(numFailed) + " of " +
+           juce::String(options.scenarioFiles.size()) + " scenarios failed";
+  return {};
+}
+
+juce::String ScenarioRunner::compareWithGolden(const juce::StringArray &trace,
+                                               const juce::File &goldenFile) {
+  if (!goldenFile.existsAsFile())
+    return "no " + goldenFile.getFileName() + " (run with --update-golden)";
+
+  juce::StringArray golden;
+  golden.addLines(goldenFile.loadFileAsString().trimEnd());
+
+  for (int line = 0; line < juce::jmax(trace.size(), golden.size()); ++line) {
+    if (line >= golden.size() || line >= trace.size() ||
+        trace[line] != golden[line])
+      return "line " + juce::String(line + 1) + ": expected '" +
+             golden[line] + "', got '" + trace[line] + "'";
+  }
+  return {};
+}
+
+//==============================================================================
+juce::String ScenarioRunner::runScenario(const juce::File &file,
+                                         juce::StringArray &trace) {
+  juce::StringArray lines;
+  lines.addLines(file.loadFileAsString());
+
+  AmenBreakChopperAudioProcessor processor;
+  ScenarioPlayHead playHead;
+  processor.setPlayHead(&playHead);
+  processor.setHeadless(true);
+  OfflineRenderer::configureForHeadless(processor);
+
+  AudioTrace audioTrace;
+  juce::AudioBuffer<float> block(2, kMaxBlockSize);
+  juce::MidiBuffer midi;
+  juce::MidiBuffer pendingMidi; // Sent at the start of the next block
+  int blockSize = 512;
+  bool prepared = false;
+  bool clockRunning = false;
+  juce::int64 clockStart = 0;
+  juce::int64 nextClockTick = 0;
+
+  for (int lineIndex = 0; lineIndex < lines.size(); ++lineIndex) {
+    const auto tokens = juce::StringArray::fromTokens(
+        lines[lineIndex].upToFirstOccurrenceOf("#", false, false), " \t", "");
+    if (tokens.isEmpty())
+      continue;
+
+    const auto location =
+        file.getFileName() + ":" + juce::String(lineIndex + 1) + ": ";
+    const auto &command = tokens[0];
+    auto number = [&tokens](int index) { return tokens[index].getDoubleValue(); };
+    auto channel = [&tokens](int index) {
+      return tokens.size() > index ? juce::jlimit(1, 16, tokens[index].getIntValue())
+                                   : 1;
+    };
+
+    if (command == "rate" && tokens.size() == 2) {
+      if (prepared)
+        return location + "'rate' must come before the first 'run'";
+      playHead.sampleRate = number(1);
+      if (playHead.sampleRate < 8000.0 || playHead.sampleRate > 384000.0)
+        return location + "invalid sample rate";
+    } else if (command == "block" && tokens.size() == 2) {
+      blockSize = tokens[1].getIntValue();
+      if (blockSize < 1 || blockSize > kMaxBlockSize)
+        return location + "invalid block size";
+    } else if (command == "bpm" && tokens.size() == 2) {
+      playHead.bpm = number(1);
+      if (playHead.bpm < 20.0 || playHead.bpm > 999.0)
+        return location + "invalid bpm";
+    } else if (command == "param" && tokens.size() == 3) {
+      auto *parameter = processor.getValueTreeState().getParameter(tokens[1]);
+      if (parameter == nullptr)
+        return location + "unknown parameter " + tokens[1];
+      parameter->setValueNotifyingHost(
+          parameter->convertTo0to1((float)number(2)));
+    } else if (command == "play" && tokens.size() <= 2) {
+      playHead.playing = true;
+      if (tokens.size() == 2)
+        playHead.ppq = number(1);
+    } else if (command == "stop" && tokens.size() == 1) {
+      playHead.playing = false;
+    } else if (command == "jump" && tokens.size() == 2) {
+      playHead.ppq = number(1);
+    } else if (command == "loop" && tokens.size() == 2 && tokens[1] == "off") {
+      playHead.looping = false;
+    } else if (command == "loop" && tokens.size() == 3) {
+      playHead.looping = true;
+      playHead.loopStart = number(1);
+      playHead.loopEnd = number(2);
+      if (playHead.loopEnd <= playHead.loopStart)
+        return location + "loop end must be after loop start";
+    } else if (command == "note" && tokens.size() >= 2 && tokens.size() <= 3) {
+      pendingMidi.addEvent(
+          juce::MidiMessage::noteOn(channel(2),
+                                    juce::jlimit(0, 127, tokens[1].getIntValue()),
+                                    (juce::uint8)100),
+          0);
+    } else if (command == "cc" && tokens.size() >= 3 && tokens.size() <= 4) {
+      pendingMidi.addEvent(juce::MidiMessage::controllerEvent(
+                               channel(3),
+                               juce::jlimit(0, 127, tokens[1].getIntValue()),
+                               juce::jlimit(0, 127, tokens[2].getIntValue())),
+                           0);
+    } else if (command == "clock" && tokens.size() == 2 &&
+               (tokens[1] == "start" || tokens[1] == "stop" ||
+                tokens[1] == "continue")) {
+      const auto &state = tokens[1];
+      clockRunning = state != "stop";
+      pendingMidi.addEvent(state == "start"  ? juce::MidiMessage::midiStart()
+                           : state == "stop" ? juce::MidiMessage::midiStop()
+                                             : juce::MidiMessage::midiContinue(),
+                           0);
+      clockStart = playHead.timeInSamples;
+      nextClockTick = 0;
+    } else if (command == "run" && tokens.size() == 2) {
+      if (!prepared) {
+        processor.setPlayConfigDetails(2, 2, playHead.sampleRate,
+                                       kMaxBlockSize);
+        processor.prepareToPlay(playHead.sampleRate, kMaxBlockSize);
+        prepared = true;
+      }
+
+      auto remaining = static_cast<juce::int64>(
+          std::round(number(1) * 60.0 / playHead.bpm * playHead.sampleRate));
+      if (remaining <= 0)
+        return location + "invalid run length";
+
+      while (remaining > 0) {
+        const int blockLength = (int)juce::jmin((juce::int64)blockSize,
+                                                remaining);
+        const auto blockStart = playHead.timeInSamples;
+
+        block.setSize(2, blockLength, false, false, true);
+        for (int i = 0; i < blockLength; ++i) {
+          const float ramp =
+              (float)((blockStart + i) % kRampPeriod) / (float)kRampPeriod;
+          block.setSample(0, i, ramp);
+          block.setSample(1, i, ramp);
+        }
+
+        midi.swapWith(pendingMidi);
+        pendingMidi.clear();
+        if (clockRunning) {
+          const double samplesPerTick =
+              playHead.sampleRate * 60.0 /
+              (playHead.bpm * MidiClockTracker::kTicksPerQuarter);
+          for (;; ++nextClockTick) {
+            const auto tickTime =
+                clockStart +
+                static_cast<juce::int64>(nextClockTick * samplesPerTick);
+            if (tickTime >= blockStart + blockLength)
+              break;
+            midi.addEvent(juce::MidiMessage::midiClock(),
+                          (int)(tickTime - blockStart));
+          }
+        }
+
+        processor.processBlock(block, midi);
+
+        for (const auto metadata : midi) {
+          const auto message = metadata.getMessage();
+          const auto time =
+              juce::String(blockStart + metadata.samplePosition) + " ";
+          if (message.isNoteOn())
+            trace.add("midi " + time + "on " +
+                      juce::String(message.getNoteNumber()));
+          else if (message.isNoteOff())
+            trace.add("midi " + time + "off " +
+                      juce::String(message.getNoteNumber()));
+        }
+        for (int i = 0; i < blockLength; ++i)
+          audioTrace.add(blockStart + i, block.getSample(0, i));
+
+        playHead.advance(blockLength);
+        remaining -= blockLength;
+      }
+    } else {
+      return location + "cannot parse '" + lines[lineIndex].trim() + "'";
+    }
+  }
+
+  if (prepared)
+    processor.releaseResources();
+  processor.setPlayHead(nullptr);
+
+  audioTrace.write(trace);
+  return {};
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    ScenarioRunner.h
+    Part of AmenBreakChopper
+
+    Golden-output regression mode of the Standalone app. Replays a scripted
+    transport / MIDI scenario through AmenBreakChopperAudioProcessor with a
+    simulated play head and compares the resulting trace against a stored
+    .golden file next to the scenario, so timing changes cannot silently
+    shift ticks or chops.
+
+      ABC --scenario <file.scenario | directory> [--update-golden]
+
+    Scenario scripts have one command per line ('#' starts a comment):
+
+      rate <hz>                 sample rate, before the first 'run'
+      block <samples>           block size from here on (default 512)
+      bpm <bpm>                 host tempo, also drives 'clock' ticks
+      param <id> <value>        set a parameter, in plain units
+      play [ppq] | stop         transport state, optionally jumping
+      jump <ppq>                move the transport without stopping
+      loop <start> <end> | loop off
+      note <0-127> [channel]    note on at the start of the next block
+      cc <number> <value> [channel]
+      clock start | stop | continue
+                                MIDI Start/Stop/Continue, 24 ppq ticks while
+                                running
+      run <beats>               process that much audio
+
+    The trace lists every generated MIDI event by absolute sample, then the
+    audio as runs of constant read delay. The input is a sample-index ramp,
+    so the delay of each output sample can be recovered exactly; crossfades
+    and other short runs are collapsed into '~'.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_processors/juce_audio_processors.h>
+
+class AmenBreakChopperAudioProcessor;
+
+class ScenarioRunner {
+public:
+  struct Options {
+    juce::Array<juce::File> scenarioFiles;
+    bool updateGolden{false};
+  };
+
+  static bool isScenarioCommandLine(const juce::StringArray &args);
+
+  // Parses the --scenario arguments. Returns an error message, or an empty
+  // string on success.
+  static juce::String parseCommandLine(const juce::StringArray &args,
+                                       Options &options);
+
+  // Runs every scenario and prints PASS / FAIL per file. Returns an error
+  // message if any scenario failed, or an empty string on success.
+  static juce::String run(const Options &options);
+
+private:
+  class ScenarioPlayHead;
+  class AudioTrace;
+
+  // Fills the trace; returns an error message for broken scripts.
+  static juce::String runScenario(const juce::File &file,
+                                  juce::StringArray &trace);
+  static juce::String compareWithGolden(const juce::StringArray &trace,
+                                        const juce::File &goldenFile);
+
+  static constexpr int kMaxBlockSize = 8192;
+  static constexpr int kRampPeriod = 1 << 18; // Exact in float at 1/64 sample
+};
@@ -13,6 +13,9 @@
 
 #include <JuceHeader.h>
 #include "PluginEditor.h"
+#include "OfflineRenderer.h"
+#include "ProcessorBenchmark.h"
+#include "ScenarioRunner.h"
 #include <stdio.h> // For printf
 
 #if JUCE_USE_CUSTOM_PLUGIN_STANDALONE_APP
@@ -128,6 +131,65 @@ public:
 
     void initialise (const juce::String&) override
     {
+        // Headless render mode: no window, no audio device (see OfflineRenderer.h)
+        const auto args = getCommandLineParameterArray();
+        if (OfflineRenderer::isRenderCommandLine (args))
+        {
+            OfflineRenderer::Options renderOptions;
+            auto error = OfflineRenderer::parseCommandLine (args, renderOptions);
+            if (error.isEmpty())
+                error = OfflineRenderer::render (renderOptions);
+
+            if (error.isEmpty())
+            {
+                printf ("Rendered %s\n", renderOptions.outputFile.getFullPathName().toRawUTF8());
+            }
+            else
+            {
+                fprintf (stderr, "%s\n", error.toRawUTF8());
+                setApplicationReturnValue (1);
+            }
+
+            quit();
+            return;
+        }
+
+        // Headless benchmark mode (see ProcessorBenchmark.h)
+        if (ProcessorBenchmark::isBenchCommandLine (args))
+        {
+            ProcessorBenchmark::Options benchOptions;
+            auto error = ProcessorBenchmark::parseCommandLine (args, benchOptions);
+            if (error.isEmpty())
+                error = ProcessorBenchmark::run (benchOptions);
+
+            if (error.isNotEmpty())
+            {
+                fprintf (stderr, "%s\n", error.toRawUTF8());
+                setApplicationReturnValue (1);
+            }
+
+            quit();
+            return;
+        }
+
+        // Golden-output regression mode (see ScenarioRunner.h)
+        if (ScenarioRunner::isScenarioCommandLine (args))
+        {
+            ScenarioRunner::Options scenarioOptions;
+            auto error = ScenarioRunner::parseCommandLine (args, scenarioOptions);
+            if (error.isEmpty())
+                error = ScenarioRunner::run (scenarioOptions);
+
+            if (error.isNotEmpty())
+            {
+                fprintf (stderr, "%s\n", error.toRawUTF8());
+                setApplicationReturnValue (1);
+            }
+
+            quit();
+            return;
+        }
+
         // Setup settings file
         juce::PropertiesFile::Options options;
         options.applicationName     = getApplicationName();
@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    WaveformSummary.cpp
+
+  ==============================================================================
+*/
+
+#include "WaveformSummary.h"
+
+void WaveformSummary::prepare(int bufferLength) {
+  jassert(bufferLength == 0 || juce::isPowerOfTwo(bufferLength));
+  mBufferLength = bufferLength;
+  mBufferMask = juce::jmax(0, bufferLength - 1);
+
+  int numLevels = 1;
+  while ((1 << getBucketShift(numLevels - 1)) < bufferLength)
+    ++numLevels;
+
+  mLevels.resize(static_cast<size_t>(numLevels));
+  for (int level = 0; level < numLevels; ++level) {
+    const int bucketSize = 1 << getBucketShift(level);
+    mLevels[static_cast<size_t>(level)].assign(
+        static_cast<size_t>((bufferLength + bucketSize - 1) / bucketSize),
+        Bucket());
+  }
+}
+
+void WaveformSummary::clear() {
+  for (auto &level : mLevels)
+    std::fill(level.begin(), level.end(), Bucket());
+}
+
+int WaveformSummary::getBucketShift(int level) {
+  return kBaseBucketShift + level * kLevelShift;
+}
+
+void WaveformSummary::update(const RingBuffer<float> &buffer,
+                             int startSample, int numSamples) {
+  if (mBufferLength == 0 || numSamples <= 0)
+    return;
+
+  jassert(buffer.getCapacity() == mBufferLength);
+
+  // Split at the wrap point of the circular buffer
+  const int firstRun = juce::jmin(numSamples, mBufferLength - startSample);
+  updateRange(buffer, startSample, startSample + firstRun);
+  if (firstRun < numSamples)
+    updateRange(buffer, 0, numSamples - firstRun);
+}
+
+void WaveformSummary::updateRange(const RingBuffer<float> &buffer, int start,
+                                  int end) {
+  int firstBucket = start >> kBaseBucketShift;
+  int lastBucket = (end - 1) >> kBaseBucketShift;
+
+  for (int bucket = firstBucket; bucket <= lastBucket; ++bucket)
+    recomputeBaseBucket(buffer, bucket);
+
+  // Every touched bucket invalidates exactly one parent per level
+  const int numLevels = static_cast<int>(mLevels.size());
+  for (int level = 1; level < numLevels; ++level) {
+    firstBucket >>= kLevelShift;
+    lastBucket >>= kLevelShift;
+    for (int bucket = firstBucket; bucket <= lastBucket; ++bucket)
+      recomputeParentBucket(level, bucket);
+  }
+}
+
+void WaveformSummary::recomputeBaseBucket(const RingBuffer<float> &buffer,
+                                          int bucketIndex) {
+  const int start = bucketIndex << kBaseBucketShift;
+  const int length = juce::jmin(kBaseBucketSize, mBufferLength - start);
+
+  Bucket result;
+  result.min = std::numeric_limits<float>::max();
+  result.max = std::numeric_limits<float>::lowest();
+
+  for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+    const auto *data = buffer.getReadPointer(channel) + start;
+    const auto range = juce::FloatVectorOperations::findMinAndMax(data, length);
+    result.min = juce::jmin(result.min, range.getStart());
+    result.max = juce::jmax(result.max, range.getEnd());
+
+    for (int i = 0; i < length; ++i)
+      result.sumSquares += data[i] * data[i];
+    result.numValues += length;
+  }
+
+  mLevels[0][static_cast<size_t>(bucketIndex)] = result;
+}
+
+void WaveformSummary::recomputeParentBucket(int level, int bucketIndex) {
+  const auto &children = mLevels[static_cast<size_t>(level - 1)];
+  const int firstChild = bucketIndex << kLevelShift;
+  const int endChild = juce::jmin(firstChild + (1 << kLevelShift),
+                                  static_cast<int>(children.size()));
+
+  Bucket result = children[static_cast<size_t>(firstChild)];
+  for (int child = firstChild + 1; child < endChild; ++child) {
+    const auto &bucket = children[static_cast<size_t>(child)];
+    result.min = juce::jmin(result.min, bucket.min);
+    result.max = juce::jmax(result.max, bucket.max);
+    result.sumSquares += bucket.sumSquares;
+    result.numValues += bucket.numValues;
+  }
+
+  mLevels[static_cast<size_t>(level)][static_cast<size_t>(bucketIndex)] =
+      result;
+}
+
+void WaveformSummary::getBins(int startSample, int numSamples, Bin *dest,
+                              int numBins) const {
+  if (mBufferLength == 0 || numSamples <= 0) {
+    std::fill(dest, dest + numBins, Bin{0.0f, 0.0f, 0.0f});
+    return;
+  }
+
+  startSample &= mBufferMask; // Also wraps negative positions
+  const int numLevels = static_cast<int>(mLevels.size());
+
+  for (int bin = 0; bin < numBins; ++bin) {
+    const int binStart = startSample + (bin * numSamples) / numBins;
+    const int binEnd = juce::jmax(
+        binStart + 1, startSample + ((bin + 1) * numSamples) / numBins);
+
+    Bucket result;
+    result.min = std::numeric_limits<float>::max();
+    result.max = std::numeric_limits<float>::lowest();
+
+    for (int position = binStart; position < binEnd;) {
+      // The coarsest bucket that starts here and ends inside the bin. Only
+      // the base bucket under an unaligned edge reaches outside it.
+      const int wrapped = position & mBufferMask;
+      int level = 0;
+      while (level + 1 < numLevels) {
+        const int size = 1 << getBucketShift(level + 1);
+        if ((wrapped & (size - 1)) != 0 || size > binEnd - position)
+          break;
+        ++level;
+      }
+
+      const int bucketShift = getBucketShift(level);
+      const int bucketIndex = wrapped >> bucketShift;
+      const auto &bucket = mLevels[static_cast<size_t>(level)]
+                                  [static_cast<size_t>(bucketIndex)];
+      result.min = juce::jmin(result.min, bucket.min);
+      result.max = juce::jmax(result.max, bucket.max);
+      result.sumSquares += bucket.sumSquares;
+      result.numValues += bucket.numValues;
+
+      const int bucketEnd =
+          juce::jmin((bucketIndex + 1) << bucketShift, mBufferLength);
+      position += bucketEnd - wrapped;
+    }
+
+    dest[bin].min = result.min;
+    dest[bin].max = result.max;
+    dest[bin].rms = result.numValues > 0
+                        ? std::sqrt(result.sumSquares /
+                                    static_cast<float>(result.numValues))
+                        : 0.0f;
+  }
+}
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    WaveformSummary.h
+
+    Multi-resolution min/max/RMS summary of the circular delay buffer. The
+    audio thread refreshes only the buckets touched by each block, and the
+    display reads any zoom level in O(bins) without touching the audio.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../../Shared/RingBuffer.h"
+#include <juce_audio_basics/juce_audio_basics.h>
+#include <vector>
+
+class WaveformSummary {
+public:
+  struct Bin {
+    float min;
+    float max;
+    float rms;
+  };
+
+  // Message thread, while the audio thread is stopped. bufferLength is the
+  // capacity of the RingBuffer being summarised, a power of two.
+  void prepare(int bufferLength);
+  void clear();
+
+  // Audio thread. Refreshes the summary for samples just written to the
+  // circular buffer; startSample may wrap around the end.
+  void update(const RingBuffer<float> &buffer, int startSample,
+              int numSamples);
+
+  // Summarises numSamples starting at the (circular) startSample into
+  // numBins bins. Each bin is covered by the coarsest buckets aligned inside
+  // it, so it only reaches past its edges within a base bucket.
+  void getBins(int startSample, int numSamples, Bin *dest, int numBins) const;
+
+private:
+  struct Bucket {
+    float min{0.0f};
+    float max{0.0f};
+    float sumSquares{0.0f};
+    int numValues{0}; // Samples x channels
+  };
+
+  // Bucket sizes are powers of two, so indexing is shifts and masks
+  static constexpr int kBaseBucketShift = 6; // 64 samples per level-0 bucket
+  static constexpr int kLevelShift = 2;      // 4 children per parent bucket
+  static constexpr int kBaseBucketSize = 1 << kBaseBucketShift;
+
+  static int getBucketShift(int level);
+  void updateRange(const RingBuffer<float> &buffer, int start, int end);
+  void recomputeBaseBucket(const RingBuffer<float> &buffer, int bucketIndex);
+  void recomputeParentBucket(int level, int bucketIndex);
+
+  int mBufferLength{0};
+  int mBufferMask{0};
+  // Levels up to the first one whose buckets span the whole buffer, so any
+  // zoom costs O(bins)
+  std::vector<std::vector<Bucket>> mLevels;
+};
@@ -16,13 +16,44 @@ AmenBreakControllerAudioProcessor::AmenBreakControllerAudioProcessor()
               .withInput("Input", juce::AudioChannelSet::stereo(), true)
               .withOutput("Output", juce::AudioChannelSet::stereo(), true)),
       mValueTreeState(*this, nullptr, "PARAMETERS", createParameterLayout()) {
+  cacheParameters();
   mValueTreeState.state.setProperty("oscHostAddress", "127.0.0.1", nullptr);
   mReceiver.addListener(this);
   mValueTreeState.addParameterListener("oscSendPort", this);
   mValueTreeState.addParameterListener("oscReceivePort", this);
+  mValueTreeState.addParameterListener("oscTransport", this);
+  OscTime::now(); // Calibrate before the audio thread reads the clock
+  startTimerHz(kParameterPublishHz);
 }
 
-AmenBreakControllerAudioProcessor::~AmenBreakControllerAudioProcessor() {}
+void AmenBreakControllerAudioProcessor::cacheParameters() {
+  auto raw = [this](const char *parameterID) {
+    auto *value = mValueTreeState.getRawParameterValue(parameterID);
+    jassert(value != nullptr);
+    return value;
+  };
+
+  mParams.midiInputChannel = raw("midiInputChannel");
+  mParams.midiOutputChannel = raw("midiOutputChannel");
+  mParams.midiCcSeqReset = raw("midiCcSeqReset");
+  mParams.midiCcSeqResetMode = raw("midiCcSeqResetMode");
+  mParams.midiCcHardReset = raw("midiCcHardReset");
+  mParams.midiCcHardResetMode = raw("midiCcHardResetMode");
+  mParams.midiCcSoftReset = raw("midiCcSoftReset");
+  mParams.midiCcSoftResetMode = raw("midiCcSoftResetMode");
+  mParams.latencyBudgetMs = raw("latencyBudgetMs");
+  mParams.oscBundling = raw("oscBundling");
+
+  mParams.sequencePosition = mValueTreeState.getParameter("sequencePosition");
+  mParams.noteSequencePosition =
+      mValueTreeState.getParameter("noteSequencePosition");
+  jassert(mParams.sequencePosition != nullptr &&
+          mParams.noteSequencePosition != nullptr);
+}
+
+AmenBreakControllerAudioProcessor::~AmenBreakControllerAudioProcessor() {
+  stopTimer();
+}
 
 //==============================================================================
 juce::AudioProcessorValueTreeState::ParameterLayout
@@ -61,6 +92,22 @@ AmenBreakControllerAudioProcessor::createParameterLayout() {
   layout.add(std::make_unique<juce::AudioParameterInt>(
       "oscReceivePort", "OSC Receive Port", 1, 65535, 9001));
 
+  // Same messages as OSC, through a memory-mapped queue when the Chopper
+  // runs on this host; OSC stays the fallback.
+  juce::StringArray oscTransports = {"UDP", "Shared Memory"};
+  layout.add(std::make_unique<juce::AudioParameterChoice>(
+      "oscTransport", "OSC Transport", oscTransports, 0));
+
+  // Delay added to time-tagged ticks before their MIDI is played
+  layout.add(std::make_unique<juce::AudioParameterFloat>(
+      "latencyBudgetMs", "Latency Budget (ms)",
+      juce::NormalisableRange<float>(0.0f, 100.0f, 0.1f), 10.0f));
+
+  // Merge each block's outgoing OSC messages into one bundle
+  juce::StringArray oscBundlingModes = {"Off", "Per Block"};
+  layout.add(std::make_unique<juce::AudioParameterChoice>(
+      "oscBundling", "OSC Bundling", oscBundlingModes, 0));
+
   return layout;
 }
 
@@ -74,13 +121,17 @@ void AmenBreakControllerAudioProcessor::parameterChanged(
   if (parameterID == "oscSendPort") {
     auto hostAddress =
         mValueTreeState.state.getProperty("oscHostAddress").toString();
-    if (!mSender.connect(hostAddress, (int)newValue))
+    if (!mOscSender.connect(hostAddress, (int)newValue))
       juce::Logger::writeToLog(
           "AmenBreakController: Failed to connect OSC sender on port change.");
+    updateSharedMemoryTransport();
   } else if (parameterID == "oscReceivePort") {
     if (!mReceiver.connect((int)newValue))
       juce::Logger::writeToLog("AmenBreakController: Failed to connect OSC "
                                "receiver on port change.");
+    updateSharedMemoryTransport();
+  } else if (parameterID == "oscTransport") {
+    updateSharedMemoryTransport();
   }
 }
 
@@ -89,14 +140,62 @@ void AmenBreakControllerAudioProcessor::setOscHostAddress(
   mValueTreeState.state.setProperty("oscHostAddress", hostAddress, nullptr);
   auto sendPort =
       (int)mValueTreeState.getRawParameterValue("oscSendPort")->load();
-  if (!mSender.connect(hostAddress, sendPort))
+  if (!mOscSender.connect(hostAddress, sendPort))
     juce::Logger::writeToLog(
         "AmenBreakController: Failed to connect OSC sender on host change.");
+  updateSharedMemoryTransport();
+}
+
+void AmenBreakControllerAudioProcessor::updateSharedMemoryTransport() {
+  const bool useSharedMemory =
+      mValueTreeState.getRawParameterValue("oscTransport")->load() >= 0.5f;
+  auto hostAddress =
+      mValueTreeState.state.getProperty("oscHostAddress").toString();
+  auto sendPort =
+      (int)mValueTreeState.getRawParameterValue("oscSendPort")->load();
+  auto receivePort =
+      (int)mValueTreeState.getRawParameterValue("oscReceivePort")->load();
+
+  // Only a peer on this host can share the queue
+  mOscSender.setSharedMemoryPort(
+      useSharedMemory && OscSenderThread::isLocalHost(hostAddress) ? sendPort
+                                                                   : 0);
+
+  const CheckedSpinLock::ScopedLockType lock(mSharedInputLock);
+  mSharedInput.close();
+  if (!useSharedMemory)
+    return;
+
+  using OpenResult = OscSenderThread::SharedQueue::OpenResult;
+  const auto result = mSharedInput.openAsConsumer(
+      OscSenderThread::SharedQueue::getFileForPort(receivePort));
+  if (result == OpenResult::inUse)
+    juce::Logger::writeToLog("AmenBreakController: Shared memory queue for port " +
+                             juce::String(receivePort) +
+                             " is used by another instance, receiving over "
+                             "OSC only.");
+  else if (result == OpenResult::failed)
+    juce::Logger::writeToLog(
+        "AmenBreakController: Failed to open shared memory queue.");
+}
+
+void AmenBreakControllerAudioProcessor::publishParameter(
+    juce::RangedAudioParameter *parameter, int value) {
+  const float normalised = parameter->convertTo0to1(static_cast<float>(value));
+  if (parameter->getValue() != normalised)
+    parameter->setValueNotifyingHost(normalised);
+}
+
+void AmenBreakControllerAudioProcessor::timerCallback() {
+  // Only the latest position of each sequence is sent to the host.
+  publishParameter(mParams.sequencePosition, mPublishedSequencePosition.load());
+  publishParameter(mParams.noteSequencePosition,
+                   mPublishedNoteSequencePosition.load());
 }
 
 void AmenBreakControllerAudioProcessor::sendOscMessage(
     const juce::OSCMessage &message) {
-  mSender.send(message);
+  mOscSender.sendNow(message);
 }
 
 //==============================================================================
@@ -125,28 +224,90 @@ void AmenBreakControllerAudioProcessor::prepareToPlay(double sampleRate,
       mValueTreeState.state.getProperty("oscHostAddress").toString();
   auto sendPort =
       (int)mValueTreeState.getRawParameterValue("oscSendPort")->load();
-  if (!mSender.connect(hostAddress, sendPort))
+  if (!mOscSender.connect(hostAddress, sendPort))
     juce::Logger::writeToLog(
         "AmenBreakController: Failed to connect OSC sender.");
+  mOscSender.startSending();
 
   auto receivePort =
       (int)mValueTreeState.getRawParameterValue("oscReceivePort")->load();
   if (!mReceiver.connect(receivePort))
     juce::Logger::writeToLog(
         "AmenBreakController: Failed to connect OSC receiver.");
+  updateSharedMemoryTransport();
 }
 
 void AmenBreakControllerAudioProcessor::releaseResources() {
-  // When playback stops, turn off any hanging notes.
-  const juce::ScopedLock sl(mQueueLock);
-  const int midiOutChannel =
-      (int)mValueTreeState.getRawParameterValue("midiOutputChannel")->load();
-  if (mLastOscNoteSeq >= 0)
-    mMidiOutputQueue.addEvent(
-        juce::MidiMessage::noteOff(midiOutChannel, 32 + mLastOscNoteSeq), 0);
-  if (mLastOscNoteNoteSeq >= 0)
-    mMidiOutputQueue.addEvent(
-        juce::MidiMessage::noteOff(midiOutChannel, mLastOscNoteNoteSeq), 0);
+  mOscSender.stopSending();
+  {
+    const CheckedSpinLock::ScopedLockType lock(mSharedInputLock);
+    mSharedInput.close(); // Lets the Chopper fall back to OSC at once
+  }
+
+  // When playback stops, turn off any hanging notes. The audio thread is
+  // idle, so they go straight into the pending list for the next block.
+  const int midiOutChannel = (int)mParams.midiOutputChannel->load();
+  if (mLastOscNoteSeq >= 0 && mNumPendingMidi < kMaxPendingMidi)
+    addPendingMidi(
+        juce::MidiMessage::noteOff(midiOutChannel, 32 + mLastOscNoteSeq), 0.0);
+  if (mLastOscNoteNoteSeq >= 0 && mNumPendingMidi < kMaxPendingMidi)
+    addPendingMidi(
+        juce::MidiMessage::noteOff(midiOutChannel, mLastOscNoteNoteSeq), 0.0);
+  mLastOscNoteSeq = -1;
+  mLastOscNoteNoteSeq = -1;
+
+  if (const int dropped = mNumDroppedMidiEvents.exchange(0))
+    juce::Logger::writeToLog("AmenBreakController: " + juce::String(dropped) +
+                             " OSC->MIDI updates dropped, queue full.");
+  RealtimeGuard::writeReport("AmenBreakController");
+}
+
+void AmenBreakControllerAudioProcessor::addPendingMidi(
+    const juce::MidiMessage &message, double time) {
+  jassert(message.getRawDataSize() <= 3);
+  jassert(mNumPendingMidi < kMaxPendingMidi);
+  auto &event = mPendingMidi[(size_t)mNumPendingMidi++];
+  event.time = time;
+  event.size = (juce::uint8)juce::jmin(3, message.getRawDataSize());
+  std::copy(message.getRawData(), message.getRawData() + event.size,
+            event.bytes);
+}
+
+// Audio thread. Each update adds at most two events to mPendingMidi.
+void AmenBreakControllerAudioProcessor::handleFeedback(
+    const OscSenderThread::Message &message) {
+  const int midiOutChannel = (int)mParams.midiOutputChannel->load();
+  const juce::uint8 velocity = 100;
+  const int newPosition = message.value;
+  if (newPosition < 0 || newPosition > 15)
+    return;
+
+  if (message.address == OscSenderThread::Address::sequencePosition) {
+    mPublishedSequencePosition.store(newPosition);
+
+    // Turn off the last note from this sequence, then turn on the new one
+    if (mLastOscNoteSeq >= 0)
+      addPendingMidi(
+          juce::MidiMessage::noteOff(midiOutChannel, 32 + mLastOscNoteSeq),
+          message.time);
+    addPendingMidi(
+        juce::MidiMessage::noteOn(midiOutChannel, 32 + newPosition, velocity),
+        message.time);
+    mLastOscNoteSeq = newPosition;
+  } else if (message.address ==
+             OscSenderThread::Address::noteSequencePosition) {
+    mPublishedNoteSequencePosition.store(newPosition);
+
+    // Turn off the last note from this sequence (see above)
+    if (mLastOscNoteNoteSeq >= 0)
+      addPendingMidi(
+          juce::MidiMessage::noteOff(midiOutChannel, mLastOscNoteNoteSeq),
+          message.time);
+    addPendingMidi(
+        juce::MidiMessage::noteOn(midiOutChannel, newPosition, velocity),
+        message.time);
+    mLastOscNoteNoteSeq = newPosition;
+  }
 }
 
 bool AmenBreakControllerAudioProcessor::isBusesLayoutSupported(
@@ -156,9 +317,20 @@ bool AmenBreakControllerAudioProcessor::isBusesLayoutSupported(
 
 void AmenBreakControllerAudioProcessor::processBlock(
     juce::AudioBuffer<float> &buffer, juce::MidiBuffer &midiMessages) {
+  const ScopedRealtimeCheck realtimeCheck; // Debug builds, see RealtimeGuard.h
+  const double blockStartTime = OscTime::now();
   buffer.clear();
-  const int midiInChannel =
-      (int)mValueTreeState.getRawParameterValue("midiInputChannel")->load();
+  const int midiInChannel = (int)mParams.midiInputChannel->load();
+
+  // Encoded and sent by the OSC sender thread
+  mOscSender.setBundleMode(mParams.oscBundling->load() >= 0.5f
+                               ? OscSenderThread::BundleMode::perBlock
+                               : OscSenderThread::BundleMode::off);
+  ++mOscBlock;
+  auto postOsc = [this](OscSenderThread::Address address, bool hasValue,
+                        int value) {
+    mOscSender.post({address, hasValue, value, 0, mOscBlock, 0.0});
+  };
 
   // --- Handle MIDI In -> OSC Out ---
   for (const auto metadata : midiMessages) {
@@ -167,46 +339,35 @@ void AmenBreakControllerAudioProcessor::processBlock(
       if (message.isNoteOn()) {
         int noteNumber = message.getNoteNumber();
         if (noteNumber >= 0 && noteNumber <= 15) {
-          mSender.send(
-              juce::OSCMessage("/setNoteSequencePosition", noteNumber));
+          postOsc(OscSenderThread::Address::setNoteSequencePosition, true,
+                  noteNumber);
         }
       } else if (message.isController()) {
         const int controllerNumber = message.getControllerNumber();
         const int controllerValue = message.getControllerValue();
 
-        const int ccSeqReset =
-            (int)mValueTreeState.getRawParameterValue("midiCcSeqReset")->load();
-        const int ccHardReset =
-            (int)mValueTreeState.getRawParameterValue("midiCcHardReset")
-                ->load();
-        const int ccSoftReset =
-            (int)mValueTreeState.getRawParameterValue("midiCcSoftReset")
-                ->load();
+        const int ccSeqReset = (int)mParams.midiCcSeqReset->load();
+        const int ccHardReset = (int)mParams.midiCcHardReset->load();
+        const int ccSoftReset = (int)mParams.midiCcSoftReset->load();
 
         if (controllerNumber == ccSeqReset) {
-          const int mode =
-              (int)mValueTreeState.getRawParameterValue("midiCcSeqResetMode")
-                  ->load();
+          const int mode = (int)mParams.midiCcSeqResetMode->load();
           if (shouldTriggerReset(mode, mLastSeqResetCcValue, controllerValue))
-            mSender.send(juce::OSCMessage("/sequenceReset"));
+            postOsc(OscSenderThread::Address::sequenceReset, false, 0);
           mLastSeqResetCcValue = controllerValue;
         }
 
         if (controllerNumber == ccHardReset) {
-          const int mode =
-              (int)mValueTreeState.getRawParameterValue("midiCcHardResetMode")
-                  ->load();
+          const int mode = (int)mParams.midiCcHardResetMode->load();
           if (shouldTriggerReset(mode, mLastHardResetCcValue, controllerValue))
-            mSender.send(juce::OSCMessage("/hardReset"));
+            postOsc(OscSenderThread::Address::hardReset, false, 0);
           mLastHardResetCcValue = controllerValue;
         }
 
         if (controllerNumber == ccSoftReset) {
-          const int mode =
-              (int)mValueTreeState.getRawParameterValue("midiCcSoftResetMode")
-                  ->load();
+          const int mode = (int)mParams.midiCcSoftResetMode->load();
           if (shouldTriggerReset(mode, mLastSoftResetCcValue, controllerValue))
-            mSender.send(juce::OSCMessage("/softReset"));
+            postOsc(OscSenderThread::Address::softReset, false, 0);
           mLastSoftResetCcValue = controllerValue;
         }
       }
@@ -215,63 +376,93 @@ void AmenBreakControllerAudioProcessor::processBlock(
   midiMessages.clear(); // We've processed all incoming MIDI.
 
   // --- Handle OSC In -> MIDI Out ---
-  const juce::ScopedLock sl(mQueueLock);
-  if (!mMidiOutputQueue.isEmpty()) {
-    for (const auto &metadata : mMidiOutputQueue) {
-      // Add all queued messages at the start of the buffer.
-      midiMessages.addEvent(metadata.getMessage(), 0);
+  // A full pending list leaves updates queued until the next block.
+  OscSenderThread::Message feedback;
+  while (mNumPendingMidi <= kMaxPendingMidi - 2 &&
+         mFeedbackQueue.pop(feedback))
+    handleFeedback(feedback);
+  {
+    const CheckedSpinLock::ScopedTryLockType lock(mSharedInputLock);
+    // setHeartbeat() fails once another instance has taken the queue over
+    if (lock.isLocked() && mSharedInput.isOpen() &&
+        mSharedInput.setHeartbeat(juce::Time::currentTimeMillis())) {
+      while (mNumPendingMidi <= kMaxPendingMidi - 2 &&
+             mSharedInput.pop(feedback))
+        handleFeedback(feedback);
+    }
+  }
+
+  const int numSamples = buffer.getNumSamples();
+  const double sampleRate = getSampleRate();
+  const double latencyBudget = mParams.latencyBudgetMs->load() * 0.001;
+
+  int numKept = 0;
+  for (int i = 0; i < mNumPendingMidi; ++i) {
+    const auto &pending = mPendingMidi[(size_t)i];
+    int samplePosition = 0;
+
+    if (pending.time > 0.0) {
+      const double secondsFromNow =
+          pending.time + latencyBudget - blockStartTime;
+      if (secondsFromNow < kMaxScheduleAheadSeconds) {
+        const double due = secondsFromNow * sampleRate;
+        if (due >= numSamples) {
+          mPendingMidi[(size_t)numKept++] = pending; // A later block
+          continue;
+        }
+        samplePosition = juce::jmax(0, static_cast<int>(due)); // Late: now
+      }
     }
-    mMidiOutputQueue.clear();
+
+    midiMessages.addEvent(pending.bytes, pending.size, samplePosition);
   }
+  mNumPendingMidi = numKept;
 }
 
 //==============================================================================
 void AmenBreakControllerAudioProcessor::oscMessageReceived(
     const juce::OSCMessage &message) {
-  const juce::ScopedLock sl(mQueueLock);
-  const int midiOutChannel =
-      (int)mValueTreeState.getRawParameterValue("midiOutputChannel")->load();
-  const juce::uint8 velocity = 100;
+  handleOscMessage(message, 0.0);
+}
 
-  if (message.getAddressPattern() == "/sequencePosition") {
-    if (message.size() > 0 && message[0].isInt32()) {
-      int newPosition = message[0].getInt32();
-      mValueTreeState.getParameter("sequencePosition")
-          ->setValueNotifyingHost(static_cast<float>(newPosition) / 15.0f);
-
-      // Turn off the last note from this sequence
-      if (mLastOscNoteSeq >= 0)
-        mMidiOutputQueue.addEvent(
-            juce::MidiMessage::noteOff(midiOutChannel, 32 + mLastOscNoteSeq),
-            0);
-
-      // Turn on the new note
-      const int note = 32 + newPosition;
-      mMidiOutputQueue.addEvent(
-          juce::MidiMessage::noteOn(midiOutChannel, note, velocity), 0);
-
-      // Store the new note number
-      mLastOscNoteSeq = newPosition;
-    }
-  } else if (message.getAddressPattern() == "/noteSequencePosition") {
-    if (message.size() > 0 && message[0].isInt32()) {
-      int newPosition = message[0].getInt32();
-      mValueTreeState.getParameter("noteSequencePosition")
-          ->setValueNotifyingHost(static_cast<float>(newPosition) / 15.0f);
-
-      // Turn off the last note from this sequence
-      if (mLastOscNoteNoteSeq >= 0)
-        mMidiOutputQueue.addEvent(
-            juce::MidiMessage::noteOff(midiOutChannel, mLastOscNoteNoteSeq), 0);
-
-      // Turn on the new note
-      const int note = newPosition;
-      mMidiOutputQueue.addEvent(
-          juce::MidiMessage::noteOn(midiOutChannel, note, velocity), 0);
-
-      // Store the new note number
-      mLastOscNoteNoteSeq = newPosition;
-    }
+void AmenBreakControllerAudioProcessor::oscBundleReceived(
+    const juce::OSCBundle &bundle) {
+  handleOscBundle(bundle, 0.0);
+}
+
+void AmenBreakControllerAudioProcessor::handleOscMessage(
+    const juce::OSCMessage &message, double time) {
+  // Notes are made on the audio thread, as for the shared memory transport
+  OscSenderThread::Message feedback{};
+  if (message.getAddressPattern() == "/sequencePosition")
+    feedback.address = OscSenderThread::Address::sequencePosition;
+  else if (message.getAddressPattern() == "/noteSequencePosition")
+    feedback.address = OscSenderThread::Address::noteSequencePosition;
+  else
+    return;
+
+  if (message.size() == 0 || !message[0].isInt32())
+    return;
+
+  feedback.hasValue = true;
+  feedback.value = message[0].getInt32();
+  feedback.time = time;
+  if (!mFeedbackQueue.push(feedback))
+    mNumDroppedMidiEvents.fetch_add(1);
+}
+
+void AmenBreakControllerAudioProcessor::handleOscBundle(
+    const juce::OSCBundle &bundle, double time) {
+  // The Chopper can send each tick's messages as one bundle, stamped with the
+  // tick's time. Nested "immediately" bundles inherit the outer time.
+  const double bundleTime = bundle.getTimeTag().isImmediately()
+                                ? time
+                                : OscTime::fromTimeTag(bundle.getTimeTag());
+  for (const auto &element : bundle) {
+    if (element.isMessage())
+      handleOscMessage(element.getMessage(), bundleTime);
+    else if (element.isBundle())
+      handleOscBundle(element.getBundle(), bundleTime);
   }
 }
 
@@ -8,9 +8,16 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_osc/juce_osc.h>
 
+#include "../../Shared/OscSenderThread.h"
+#include "../../Shared/OscTime.h"
+#include "../../Shared/RealtimeGuard.h"
+#include "../../Shared/SpscQueue.h"
+
 //==============================================================================
 /**
  */
@@ -18,7 +25,8 @@ class AmenBreakControllerAudioProcessor
     : public juce::AudioProcessor,
       private juce::OSCReceiver::Listener<
           juce::OSCReceiver::MessageLoopCallback>,
-      public juce::AudioProcessorValueTreeState::Listener {
+      public juce::AudioProcessorValueTreeState::Listener,
+      private juce::Timer {
 public:
   //==============================================================================
   AmenBreakControllerAudioProcessor();
@@ -69,9 +77,65 @@ private:
   createParameterLayout();
   juce::AudioProcessorValueTreeState mValueTreeState;
 
-  // --- Thread-safe MIDI queue for OSC->MIDI feedback ---
-  juce::CriticalSection mQueueLock;
-  juce::MidiBuffer mMidiOutputQueue;
+  // Parameter pointers resolved once in the constructor, so the hot paths
+  // never look parameters up by string ID.
+  struct CachedParameters {
+    std::atomic<float> *midiInputChannel{nullptr};
+    std::atomic<float> *midiOutputChannel{nullptr};
+    std::atomic<float> *midiCcSeqReset{nullptr};
+    std::atomic<float> *midiCcSeqResetMode{nullptr};
+    std::atomic<float> *midiCcHardReset{nullptr};
+    std::atomic<float> *midiCcHardResetMode{nullptr};
+    std::atomic<float> *midiCcSoftReset{nullptr};
+    std::atomic<float> *midiCcSoftResetMode{nullptr};
+    std::atomic<float> *latencyBudgetMs{nullptr};
+    std::atomic<float> *oscBundling{nullptr};
+
+    juce::RangedAudioParameter *sequencePosition{nullptr};
+    juce::RangedAudioParameter *noteSequencePosition{nullptr};
+  };
+  CachedParameters mParams;
+
+  void cacheParameters();
+
+  // --- OSC->MIDI feedback ---
+  // Position updates from the Chopper arrive over OSC (queued by the message
+  // thread in mFeedbackQueue) or through shared memory (mSharedInput). Both
+  // are drained at the top of processBlock, and the audio thread alone turns
+  // them into notes. A full queue drops and counts updates, never waits.
+  //
+  // Updates from time-tagged bundles carry the Chopper's tick time. Their
+  // notes are held in mPendingMidi until the block that contains tick time
+  // + the latency budget, and placed on that sample; untagged and late ones
+  // go out at sample 0 of the next block.
+  struct MidiEvent {
+    juce::uint8 bytes[3];
+    juce::uint8 size;
+    double time; // OscTime seconds, 0 = as soon as possible
+  };
+  static constexpr int kFeedbackQueueCapacity = 256;
+  static constexpr int kMaxPendingMidi = 256;
+  static constexpr double kMaxScheduleAheadSeconds = 1.0; // Clock mismatch
+  SpscQueue<OscSenderThread::Message, kFeedbackQueueCapacity> mFeedbackQueue;
+  CheckedSpinLock mSharedInputLock; // Only try-locked by the audio thread
+  OscSenderThread::SharedQueue mSharedInput;
+  std::array<MidiEvent, kMaxPendingMidi> mPendingMidi; // Audio thread
+  int mNumPendingMidi{0};
+  std::atomic<int> mNumDroppedMidiEvents{0};
+
+  void handleFeedback(const OscSenderThread::Message &message);
+  void addPendingMidi(const juce::MidiMessage &message, double time);
+  void updateSharedMemoryTransport();
+
+  // --- Parameter publication ---
+  // The audio thread only writes these atomics; a message-thread timer hands
+  // them to the host.
+  static constexpr int kParameterPublishHz = 60;
+  std::atomic<int> mPublishedSequencePosition{0};
+  std::atomic<int> mPublishedNoteSequencePosition{0};
+
+  void publishParameter(juce::RangedAudioParameter *parameter, int value);
+  void timerCallback() override;
 
   // --- CC Value State ---
   int mLastSeqResetCcValue{0};
@@ -79,12 +143,16 @@ private:
   int mLastSoftResetCcValue{0};
 
   // --- OSC State ---
-  juce::OSCSender mSender;
+  OscSenderThread mOscSender{"AmenBreakController OSC Sender"};
+  juce::uint32 mOscBlock{0}; // Groups each block's messages for bundling
   juce::OSCReceiver mReceiver;
-  int mLastOscNoteSeq{-1};
-  int mLastOscNoteNoteSeq{-1};
+  int mLastOscNoteSeq{-1};     // Audio thread
+  int mLastOscNoteNoteSeq{-1}; // Audio thread
 
   void oscMessageReceived(const juce::OSCMessage &message) override;
+  void oscBundleReceived(const juce::OSCBundle &bundle) override;
+  void handleOscMessage(const juce::OSCMessage &message, double time);
+  void handleOscBundle(const juce::OSCBundle &bundle, double time);
   bool shouldTriggerReset(int mode, int previousValue, int currentValue);
 
   JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(
@@ -0,0 +1,256 @@
+/*
+  ==============================================================================
+
+    OscSenderThread.cpp
+    Shared by AmenBreakChopper and AmenBreakController
+
+  ==============================================================================
+*/
+
+#include "OscSenderThread.h"
+
+OscSenderThread::OscSenderThread(const juce::String &threadName)
+    : juce::Thread(threadName) {
+  OscTime::now(); // Calibrate before the audio thread stamps anything
+}
+
+OscSenderThread::~OscSenderThread() { stopSending(); }
+
+bool OscSenderThread::connect(const juce::String &hostName, int portNumber) {
+  const juce::ScopedLock sl(mSenderLock);
+  return mSender.connect(hostName, portNumber);
+}
+
+void OscSenderThread::startSending() {
+  if (!isThreadRunning())
+    startThread();
+}
+
+void OscSenderThread::stopSending() {
+  stopThread(100);
+  mQueue.reset();
+
+  const CheckedSpinLock::ScopedLockType lock(mSharedOutputLock);
+  mSharedOutput.close();
+  mOpenSharedMemoryPort = 0;
+  mInUseSharedMemoryPort = 0;
+  mLastSharedMemoryAttempt = 0;
+}
+
+bool OscSenderThread::post(const Message &message) {
+  if (mSharedMemoryPort.load() != 0) {
+    const CheckedSpinLock::ScopedTryLockType lock(mSharedOutputLock);
+    if (lock.isLocked() && mSharedOutput.isOpen() &&
+        mSharedOutput.isProducerOwner() &&
+        mSharedOutput.isConsumerAlive(juce::Time::currentTimeMillis())) {
+      if (mSharedOutput.push(message))
+        return true;
+
+      mNumDropped.fetch_add(1);
+      return false;
+    }
+  }
+
+  if (mQueue.push(message))
+    return true;
+
+  mNumDropped.fetch_add(1);
+  return false;
+}
+
+bool OscSenderThread::sendNow(const juce::OSCMessage &message) {
+  const juce::ScopedLock sl(mSenderLock);
+  return mSender.send(message);
+}
+
+bool OscSenderThread::parseAddress(const juce::String &addressString,
+                                   Address &address) {
+  for (const auto candidate :
+       {Address::sequencePosition, Address::noteSequencePosition,
+        Address::setNoteSequencePosition, Address::sequenceReset,
+        Address::hardReset, Address::softReset, Address::delayTime}) {
+    if (addressString == getAddressString(candidate)) {
+      address = candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OscSenderThread::isLocalHost(const juce::String &hostName) {
+  return hostName == "127.0.0.1" || hostName == "::1" ||
+         hostName.equalsIgnoreCase("localhost");
+}
+
+const char *OscSenderThread::getAddressString(Address address) {
+  switch (address) {
+  case Address::sequencePosition:
+    return "/sequencePosition";
+  case Address::noteSequencePosition:
+    return "/noteSequencePosition";
+  case Address::setNoteSequencePosition:
+    return "/setNoteSequencePosition";
+  case Address::sequenceReset:
+    return "/sequenceReset";
+  case Address::hardReset:
+    return "/hardReset";
+  case Address::softReset:
+    return "/softReset";
+  case Address::delayTime:
+    return "/delayTime";
+  }
+  return "/";
+}
+
+void OscSenderThread::run() {
+  // Polling keeps the audio thread free of any wake-up call (which would take
+  // a lock inside WaitableEvent). The interval doubles while the queue stays
+  // empty, so idle instances wake a few hundred times a second, not 1000.
+  int pollIntervalMs = kMinPollIntervalMs;
+  while (!threadShouldExit()) {
+    updateSharedMemory();
+    if (mQueue.getNumReady() > 0) {
+      sendPending();
+      pollIntervalMs = kMinPollIntervalMs;
+    } else {
+      pollIntervalMs = juce::jmin(pollIntervalMs * 2, kMaxPollIntervalMs);
+    }
+    wait(pollIntervalMs);
+  }
+}
+
+void OscSenderThread::updateSharedMemory() {
+  const int port = mSharedMemoryPort.load();
+  const auto now = juce::Time::currentTimeMillis();
+  if (port == mOpenSharedMemoryPort &&
+      (port == 0 || (mSharedOutput.isConsumerAlive(now) &&
+                     mSharedOutput.setProducerHeartbeat(now))))
+    return;
+
+  // A missing or silent peer is retried now and then, not on every poll.
+  if (now - mLastSharedMemoryAttempt < kSharedMemoryRetryMs)
+    return;
+  mLastSharedMemoryAttempt = now;
+
+  const CheckedSpinLock::ScopedLockType lock(mSharedOutputLock);
+  mOpenSharedMemoryPort = 0;
+  const auto result =
+      port != 0 ? mSharedOutput.openAsProducer(SharedQueue::getFileForPort(port))
+                : SharedQueue::OpenResult::failed;
+  if (result == SharedQueue::OpenResult::opened)
+    mOpenSharedMemoryPort = port;
+  else
+    mSharedOutput.close();
+
+  // Logged once per port, not on every retry
+  if (result == SharedQueue::OpenResult::inUse &&
+      port != mInUseSharedMemoryPort)
+    juce::Logger::writeToLog(
+        getThreadName() + ": Shared memory queue for port " +
+        juce::String(port) +
+        " is used by another instance, sending over OSC.");
+  mInUseSharedMemoryPort =
+      result == SharedQueue::OpenResult::inUse ? port : 0;
+}
+
+void OscSenderThread::sendPending() {
+  const juce::ScopedLock sl(mSenderLock);
+  const auto mode = mBundleMode.load();
+
+  // A block still being posted when the queue runs dry goes out as two
+  // groups; only coalescing across the split is lost.
+  int numGrouped = 0;
+  Message message;
+  while (mQueue.pop(message)) {
+    if (numGrouped > 0 && (message.block != mGroup[0].block ||
+                           numGrouped == kMaxGroupSize)) {
+      sendGroup(numGrouped, mode);
+      numGrouped = 0;
+    }
+
+    dropSuperseded(message, numGrouped);
+    mGroup[(size_t)numGrouped++] = message;
+  }
+
+  if (numGrouped > 0)
+    sendGroup(numGrouped, mode);
+}
+
+void OscSenderThread::dropSuperseded(const Message &message,
+                                     int &numGrouped) {
+  if (!isSetterAddress(message.address))
+    return;
+
+  // Only the receiver's latest value matters. A reset in between is a
+  // barrier, since it may depend on the value set before it.
+  for (int i = numGrouped; --i >= 0;) {
+    const auto address = mGroup[(size_t)i].address;
+    if (address == message.address) {
+      std::move(mGroup.begin() + i + 1, mGroup.begin() + numGrouped,
+                mGroup.begin() + i);
+      --numGrouped;
+      return;
+    }
+    if (address == Address::sequenceReset || address == Address::hardReset ||
+        address == Address::softReset)
+      return;
+  }
+}
+
+void OscSenderThread::sendGroup(int numGrouped, BundleMode mode) {
+  if (mode == BundleMode::off) {
+    for (int i = 0; i < numGrouped; ++i) {
+      const auto &message = mGroup[(size_t)i];
+
+      // Only bundles carry a time tag, so stamped messages always go in one
+      if (message.time > 0.0) {
+        juce::OSCBundle stamped(OscTime::toTimeTag(message.time));
+        stamped.addElement(makeOscMessage(message));
+        mSender.send(stamped);
+      } else {
+        mSender.send(makeOscMessage(message));
+      }
+    }
+    return;
+  }
+
+  // Per tick: one bundle per tick, tagged with its time. Per block: one
+  // bundle for everything, with stamped ticks nested as their own bundles.
+  juce::OSCBundle blockBundle;
+  for (int start = 0; start < numGrouped;) {
+    const auto &first = mGroup[(size_t)start];
+    int end = start + 1;
+    while (end < numGrouped && mGroup[(size_t)end].tick == first.tick)
+      ++end;
+
+    if (mode == BundleMode::perBlock && first.time <= 0.0) {
+      for (int i = start; i < end; ++i)
+        blockBundle.addElement(makeOscMessage(mGroup[(size_t)i]));
+    } else {
+      juce::OSCBundle tickBundle(OscTime::toTimeTag(first.time));
+      for (int i = start; i < end; ++i)
+        tickBundle.addElement(makeOscMessage(mGroup[(size_t)i]));
+
+      if (mode == BundleMode::perTick)
+        mSender.send(tickBundle);
+      else
+        blockBundle.addElement(tickBundle);
+    }
+    start = end;
+  }
+
+  if (blockBundle.size() > 0)
+    mSender.send(blockBundle);
+}
+
+juce::OSCMessage OscSenderThread::makeOscMessage(const Message &message) {
+  juce::OSCMessage oscMessage(getAddressString(message.address));
+  if (message.hasValue)
+    oscMessage.addInt32(message.value);
+  return oscMessage;
+}
+
+bool OscSenderThread::isSetterAddress(Address address) {
+  return address == Address::delayTime ||
+         address == Address::setNoteSequencePosition;
+}
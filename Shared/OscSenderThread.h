@@ -0,0 +1,125 @@
+/*
+  ==============================================================================
+
+    OscSenderThread.h
+    Shared by AmenBreakChopper and AmenBreakController
+
+    Moves OSC encoding and the UDP send off the audio thread. The audio
+    thread posts compact messages into a preallocated queue, and a background
+    thread turns them into juce::OSCMessage / juce::OSCBundle objects and
+    sends them.
+
+    Messages are grouped by the processBlock call that posted them. Within a
+    group only the last value of a setter address (/delayTime,
+    /setNoteSequencePosition) is sent, and the group can go out as one
+    bundle per tick or a single bundle per block.
+
+    With a shared memory port set, post() writes straight into the peer's
+    SharedMemoryQueue while that peer is alive, and only falls back to the
+    OSC path when it is not. The queue is (re)mapped by the sending thread.
+    Those messages skip the grouping on purpose: the peer applies every
+    message in order, so a superseded setter costs one queue slot rather
+    than a packet, and waiting for the sending thread would add its poll
+    interval to the latency this transport exists to avoid.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <juce_osc/juce_osc.h>
+
+#include "OscTime.h"
+#include "RealtimeGuard.h"
+#include "SharedMemoryQueue.h"
+#include "SpscQueue.h"
+
+class OscSenderThread : private juce::Thread {
+public:
+  // Every OSC address exchanged between the Chopper and the Controller.
+  enum class Address : juce::uint8 {
+    sequencePosition = 0,
+    noteSequencePosition,
+    setNoteSequencePosition,
+    sequenceReset,
+    hardReset,
+    softReset,
+    delayTime
+  };
+
+  // Plain-data message that can be posted from the audio thread.
+  struct Message {
+    Address address;
+    bool hasValue;
+    int value;
+    juce::uint32 tick;  // Messages posted with the same tick can share a bundle
+    juce::uint32 block; // Same for the posting processBlock call
+    double time;        // OscTime seconds, sent as the bundle time tag; 0 = now
+  };
+
+  enum class BundleMode { off = 0, perTick, perBlock };
+
+  // Same-host transport; the receiving processor owns the consumer side.
+  using SharedQueue = SharedMemoryQueue<Message, 1024>;
+
+  explicit OscSenderThread(const juce::String &threadName);
+  ~OscSenderThread() override;
+
+  // Message thread
+  bool connect(const juce::String &hostName, int portNumber);
+  void startSending();
+  void stopSending();
+
+  // Audio thread. Never allocates or blocks; returns false if the queue is
+  // full and the message was dropped.
+  bool post(const Message &message);
+
+  // Message thread. Sends right away, for user actions outside the audio
+  // callback (the queue only takes the audio thread's posts).
+  bool sendNow(const juce::OSCMessage &message);
+
+  void setBundleMode(BundleMode mode) { mBundleMode.store(mode); }
+
+  // Message thread. 0 sends over OSC only.
+  void setSharedMemoryPort(int port) { mSharedMemoryPort.store(port); }
+
+  int getNumDropped() const { return mNumDropped.load(); }
+
+  static const char *getAddressString(Address address);
+  static bool parseAddress(const juce::String &addressString, Address &address);
+  static bool isLocalHost(const juce::String &hostName);
+
+private:
+  void run() override;
+  void sendPending();
+  void updateSharedMemory();
+  void dropSuperseded(const Message &message, int &numGrouped);
+  void sendGroup(int numGrouped, BundleMode mode);
+
+  static juce::OSCMessage makeOscMessage(const Message &message);
+  static bool isSetterAddress(Address address);
+
+  static constexpr int kMinPollIntervalMs = 1;
+  static constexpr int kMaxPollIntervalMs = 5;
+  static constexpr int kMaxGroupSize = 64;
+  static constexpr int kSharedMemoryRetryMs = 500;
+
+  juce::CriticalSection mSenderLock; // connect() vs. the sending thread
+  juce::OSCSender mSender;
+  SpscQueue<Message, 1024> mQueue;
+  std::array<Message, kMaxGroupSize> mGroup; // Sending thread only
+  std::atomic<BundleMode> mBundleMode{BundleMode::off};
+  std::atomic<int> mNumDropped{0};
+
+  // The audio thread only try-locks, so remapping never blocks it.
+  CheckedSpinLock mSharedOutputLock;
+  SharedQueue mSharedOutput;
+  std::atomic<int> mSharedMemoryPort{0};
+  int mOpenSharedMemoryPort{0};            // Sending thread
+  int mInUseSharedMemoryPort{0};           // Sending thread
+  juce::int64 mLastSharedMemoryAttempt{0}; // Sending thread
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(OscSenderThread)
+};
@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    OscTime.h
+    Shared by AmenBreakChopper and AmenBreakController
+
+    High-resolution wall clock shared by processes on one host, and its
+    conversion to and from OSC (NTP) time tags. The Chopper stamps each tick
+    with the time its sample is processed; the Controller schedules the MIDI
+    it derives from that tick at the matching sample offset.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_osc/juce_osc.h>
+
+namespace OscTime {
+// Seconds since the Unix epoch, with the resolution of the high-resolution
+// counter. Call once from the message thread before the audio thread does:
+// the first call spins for up to a millisecond to calibrate.
+inline double now() {
+  static const double offsetMs = [] {
+    // Calibrate on a tick of the millisecond wall clock, so two processes
+    // agree to within the counter resolution rather than a millisecond.
+    const auto start = juce::Time::currentTimeMillis();
+    auto wall = start;
+    while (wall == start)
+      wall = juce::Time::currentTimeMillis();
+    return static_cast<double>(wall) -
+           juce::Time::getMillisecondCounterHiRes();
+  }();
+  return (offsetMs + juce::Time::getMillisecondCounterHiRes()) * 0.001;
+}
+
+constexpr double kNtpEpochOffset = 2208988800.0; // 1900 -> 1970
+constexpr double kNtpFractionScale = 4294967296.0;
+
+// 0 means "immediately", as for an OSC time tag.
+inline juce::OSCTimeTag toTimeTag(double seconds) {
+  if (seconds <= 0.0)
+    return juce::OSCTimeTag::immediately;
+
+  const double ntp = seconds + kNtpEpochOffset;
+  const auto whole = static_cast<juce::uint64>(ntp);
+  const auto fraction = static_cast<juce::uint64>(
+      (ntp - static_cast<double>(whole)) * kNtpFractionScale);
+  return juce::OSCTimeTag((whole << 32) | (fraction & 0xffffffffu));
+}
+
+inline double fromTimeTag(const juce::OSCTimeTag &timeTag) {
+  if (timeTag.isImmediately())
+    return 0.0;
+
+  const auto raw = timeTag.getRawTimeTag();
+  return static_cast<double>(raw >> 32) - kNtpEpochOffset +
+         static_cast<double>(raw & 0xffffffffu) / kNtpFractionScale;
+}
+} // namespace OscTime
@@ -0,0 +1,318 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.cpp
+    Shared by AmenBreakChopper and AmenBreakController
+
+  ==============================================================================
+*/
+
+#include "RealtimeGuard.h"
+
+#if AMENBREAK_REALTIME_GUARD
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+#if JUCE_MAC || JUCE_IOS || JUCE_LINUX
+#include <dlfcn.h>
+#include <pthread.h>
+#endif
+
+namespace {
+thread_local int realtimeScopeDepth = 0;
+thread_local bool recordingViolation = false;
+thread_local bool skipLockHook = false;
+
+// Fixed-size, lock-free table of call sites; recording must not allocate.
+struct CallSite {
+  std::atomic<void *> address{nullptr};
+  std::atomic<int> violation{0};
+  std::atomic<int> count{0};
+};
+
+constexpr int kMaxCallSites = 128;
+std::array<CallSite, kMaxCallSites> callSites;
+std::atomic<int> numOverflowed{0};
+std::atomic<juce::int64> numAllocations{0};
+std::atomic<bool> assertOnViolation{true};
+
+const char *getViolationName(int violation) {
+  switch (static_cast<RealtimeGuard::Violation>(violation)) {
+  case RealtimeGuard::Violation::allocation:
+    return "allocation";
+  case RealtimeGuard::Violation::deallocation:
+    return "deallocation";
+  case RealtimeGuard::Violation::lock:
+    return "lock";
+  }
+  return "unknown";
+}
+
+juce::String describeCallSite(void *address) {
+  juce::String description =
+      "0x" + juce::String::toHexString(static_cast<juce::pointer_sized_int>(
+                 reinterpret_cast<juce::pointer_sized_uint>(address)));
+#if JUCE_MAC || JUCE_IOS || JUCE_LINUX
+  Dl_info info;
+  if (dladdr(address, &info) != 0 && info.dli_sname != nullptr)
+    description << " " << info.dli_sname;
+#endif
+  return description;
+}
+
+void *allocate(std::size_t size, void *callSite) {
+  if (realtimeScopeDepth > 0)
+    RealtimeGuard::recordViolation(RealtimeGuard::Violation::allocation,
+                                   callSite);
+  if (auto *memory = std::malloc(size == 0 ? 1 : size))
+    return memory;
+  throw std::bad_alloc();
+}
+
+void release(void *memory, void *callSite) noexcept {
+  if (memory == nullptr)
+    return;
+  if (realtimeScopeDepth > 0)
+    RealtimeGuard::recordViolation(RealtimeGuard::Violation::deallocation,
+                                   callSite);
+  std::free(memory);
+}
+
+#if __cpp_aligned_new
+// Over-aligned types (alignas above the default new alignment) come here.
+// Windows cannot free() these, so each side uses the matching CRT call.
+void *allocateAligned(std::size_t size, std::size_t alignment,
+                      void *callSite) {
+  if (realtimeScopeDepth > 0)
+    RealtimeGuard::recordViolation(RealtimeGuard::Violation::allocation,
+                                   callSite);
+#if JUCE_WINDOWS
+  if (auto *memory = _aligned_malloc(size == 0 ? 1 : size, alignment))
+    return memory;
+#else
+  void *memory = nullptr;
+  if (posix_memalign(&memory, juce::jmax(alignment, sizeof(void *)),
+                     size == 0 ? 1 : size) == 0)
+    return memory;
+#endif
+  throw std::bad_alloc();
+}
+
+void releaseAligned(void *memory, void *callSite) noexcept {
+  if (memory == nullptr)
+    return;
+  if (realtimeScopeDepth > 0)
+    RealtimeGuard::recordViolation(RealtimeGuard::Violation::deallocation,
+                                   callSite);
+#if JUCE_WINDOWS
+  _aligned_free(memory);
+#else
+  std::free(memory);
+#endif
+}
+#endif
+} // namespace
+
+bool RealtimeGuard::isInRealtimeScope() { return realtimeScopeDepth > 0; }
+
+void RealtimeGuard::recordViolation(Violation violation, void *callSite) {
+  // jassert and the table itself must not report back into here
+  if (recordingViolation)
+    return;
+  recordingViolation = true;
+
+  if (violation == Violation::allocation)
+    numAllocations.fetch_add(1);
+
+  const int kind = static_cast<int>(violation);
+  const auto hash = reinterpret_cast<juce::pointer_sized_uint>(callSite);
+  bool found = false;
+
+  for (int probe = 0; probe < kMaxCallSites && !found; ++probe) {
+    auto &site = callSites[(hash + (juce::pointer_sized_uint)probe) %
+                           kMaxCallSites];
+    void *expected = nullptr;
+    if (site.address.compare_exchange_strong(expected, callSite)) {
+      // New call site: stop in the debugger once, then just count
+      site.violation.store(kind);
+      site.count.fetch_add(1);
+      found = true;
+      if (assertOnViolation.load())
+        jassertfalse;
+    } else if (expected == callSite && site.violation.load() == kind) {
+      site.count.fetch_add(1);
+      found = true;
+    }
+  }
+
+  if (!found)
+    numOverflowed.fetch_add(1);
+
+  recordingViolation = false;
+}
+
+void RealtimeGuard::writeReport(const juce::String &owner) {
+  for (auto &site : callSites) {
+    auto *address = site.address.load();
+    if (address == nullptr)
+      continue;
+
+    juce::Logger::writeToLog(
+        owner + ": realtime " + getViolationName(site.violation.load()) +
+        " x" + juce::String(site.count.exchange(0)) + " at " +
+        describeCallSite(address));
+    site.address.store(nullptr);
+  }
+
+  if (const int overflowed = numOverflowed.exchange(0))
+    juce::Logger::writeToLog(owner + ": " + juce::String(overflowed) +
+                             " realtime violations at unrecorded call sites");
+}
+
+void RealtimeGuard::skipNextLockHook() { skipLockHook = true; }
+
+juce::int64 RealtimeGuard::getNumAllocations() {
+  return numAllocations.load();
+}
+
+void RealtimeGuard::setAssertOnViolation(bool shouldAssert) {
+  assertOnViolation.store(shouldAssert);
+}
+
+ScopedRealtimeCheck::ScopedRealtimeCheck() { ++realtimeScopeDepth; }
+ScopedRealtimeCheck::~ScopedRealtimeCheck() { --realtimeScopeDepth; }
+
+//==============================================================================
+// Global replacements. AMENBREAK_NO_INLINE keeps the return address pointing
+// at the code that asked for memory.
+AMENBREAK_NO_INLINE void *operator new(std::size_t size) {
+  return allocate(size, AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void *operator new[](std::size_t size) {
+  return allocate(size, AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void *operator new(std::size_t size,
+                                       const std::nothrow_t &) noexcept {
+  try {
+    return allocate(size, AMENBREAK_CALL_SITE());
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+AMENBREAK_NO_INLINE void *operator new[](std::size_t size,
+                                         const std::nothrow_t &) noexcept {
+  try {
+    return allocate(size, AMENBREAK_CALL_SITE());
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+AMENBREAK_NO_INLINE void operator delete(void *memory) noexcept {
+  release(memory, AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void operator delete[](void *memory) noexcept {
+  release(memory, AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void operator delete(void *memory, std::size_t) noexcept {
+  release(memory, AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void operator delete[](void *memory, std::size_t) noexcept {
+  release(memory, AMENBREAK_CALL_SITE());
+}
+
+#if __cpp_aligned_new
+AMENBREAK_NO_INLINE void *operator new(std::size_t size,
+                                       std::align_val_t alignment) {
+  return allocateAligned(size, static_cast<std::size_t>(alignment),
+                         AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void *operator new[](std::size_t size,
+                                         std::align_val_t alignment) {
+  return allocateAligned(size, static_cast<std::size_t>(alignment),
+                         AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void *operator new(std::size_t size,
+                                       std::align_val_t alignment,
+                                       const std::nothrow_t &) noexcept {
+  try {
+    return allocateAligned(size, static_cast<std::size_t>(alignment),
+                           AMENBREAK_CALL_SITE());
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+AMENBREAK_NO_INLINE void *operator new[](std::size_t size,
+                                         std::align_val_t alignment,
+                                         const std::nothrow_t &) noexcept {
+  try {
+    return allocateAligned(size, static_cast<std::size_t>(alignment),
+                           AMENBREAK_CALL_SITE());
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+AMENBREAK_NO_INLINE void operator delete(void *memory,
+                                         std::align_val_t) noexcept {
+  releaseAligned(memory, AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void operator delete[](void *memory,
+                                           std::align_val_t) noexcept {
+  releaseAligned(memory, AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void operator delete(void *memory, std::size_t,
+                                         std::align_val_t) noexcept {
+  releaseAligned(memory, AMENBREAK_CALL_SITE());
+}
+
+AMENBREAK_NO_INLINE void operator delete[](void *memory, std::size_t,
+                                           std::align_val_t) noexcept {
+  releaseAligned(memory, AMENBREAK_CALL_SITE());
+}
+#endif
+
+#if JUCE_MAC || JUCE_IOS || JUCE_LINUX
+//==============================================================================
+// Hidden, so the static linker binds every pthread_mutex_lock call in the
+// plugin binary (juce::CriticalSection, std::mutex) to this definition
+// without touching the host's or other plugins' calls. The real function is
+// the next definition in lookup order. trylock is not hooked: failing fast
+// is what the audio thread should do.
+extern "C" __attribute__((visibility("hidden"))) AMENBREAK_NO_INLINE int
+pthread_mutex_lock(pthread_mutex_t *mutex) {
+  using LockFunction = int (*)(pthread_mutex_t *);
+  static std::atomic<LockFunction> realLock{nullptr};
+
+  auto lock = realLock.load(std::memory_order_acquire);
+  if (lock == nullptr) {
+    lock = reinterpret_cast<LockFunction>(
+        dlsym(RTLD_NEXT, "pthread_mutex_lock"));
+    realLock.store(lock, std::memory_order_release);
+  }
+
+  // A CheckedCriticalSection has reported this one under its caller already
+  const bool alreadyReported = std::exchange(skipLockHook, false);
+  if (realtimeScopeDepth > 0 && !alreadyReported)
+    RealtimeGuard::recordViolation(RealtimeGuard::Violation::lock,
+                                   AMENBREAK_CALL_SITE());
+  return lock(mutex);
+}
+#endif
+
+#endif
@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    RealtimeGuard.h
+    Shared by AmenBreakChopper and AmenBreakController
+
+    Debug instrumentation for the audio thread. While a ScopedRealtimeCheck is
+    alive on the current thread, every heap allocation, heap free and
+    blocking lock acquisition is recorded by call site. The first hit of each
+    site trips a jassert, and RealtimeGuard::writeReport() logs the counts
+    from the message thread.
+
+    Locks are caught in two ways. On macOS and Linux pthread_mutex_lock is
+    interposed for everything linked into the plugin, which covers
+    juce::CriticalSection and std::mutex, including the ones taken inside
+    JUCE; locks taken inside the host or system libraries are not seen. On
+    every platform CheckedCriticalSection and CheckedSpinLock report a
+    blocking enter(), which is the only lock check on Windows and the only
+    one that sees spin locks.
+
+    Enabled by default in debug builds (it replaces the global operator
+    new/delete); set AMENBREAK_REALTIME_GUARD=0 to opt out. In release
+    builds everything compiles to nothing.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#ifndef AMENBREAK_REALTIME_GUARD
+#if JUCE_DEBUG
+#define AMENBREAK_REALTIME_GUARD 1
+#else
+#define AMENBREAK_REALTIME_GUARD 0
+#endif
+#endif
+
+// Return address of the enclosing function, used to identify call sites.
+// Functions that take it must not be inlined into their callers.
+#if JUCE_MSVC
+#include <intrin.h>
+#define AMENBREAK_CALL_SITE() _ReturnAddress()
+#define AMENBREAK_NO_INLINE __declspec(noinline)
+#else
+#define AMENBREAK_CALL_SITE() __builtin_return_address(0)
+#define AMENBREAK_NO_INLINE __attribute__((noinline))
+#endif
+
+namespace RealtimeGuard {
+enum class Violation { allocation = 0, deallocation, lock };
+
+#if AMENBREAK_REALTIME_GUARD
+bool isInRealtimeScope();
+void recordViolation(Violation violation, void *callSite);
+
+// Makes the pthread hook skip the next lock on this thread, for a wrapper
+// that has just reported it under its caller's address.
+void skipNextLockHook();
+
+// Message thread. Logs every recorded call site with its count and resets
+// the table.
+void writeReport(const juce::String &owner);
+
+// Running total of allocations made inside realtime scopes, for benchmarks.
+juce::int64 getNumAllocations();
+
+// Benchmarks count violations without stopping on the first one.
+void setAssertOnViolation(bool shouldAssert);
+#else
+inline bool isInRealtimeScope() { return false; }
+inline void recordViolation(Violation, void *) {}
+inline void skipNextLockHook() {}
+inline void writeReport(const juce::String &) {}
+inline juce::int64 getNumAllocations() { return 0; }
+inline void setAssertOnViolation(bool) {}
+#endif
+} // namespace RealtimeGuard
+
+class ScopedRealtimeCheck {
+public:
+#if AMENBREAK_REALTIME_GUARD
+  ScopedRealtimeCheck();
+  ~ScopedRealtimeCheck();
+#else
+  ScopedRealtimeCheck() = default;
+#endif
+
+  ScopedRealtimeCheck(const ScopedRealtimeCheck &) = delete;
+  ScopedRealtimeCheck &operator=(const ScopedRealtimeCheck &) = delete;
+};
+
+// juce::CriticalSection that reports being entered from a realtime scope.
+// Unlike the pthread hook it names the caller rather than
+// CriticalSection::enter, and it also works on Windows.
+class CheckedCriticalSection {
+public:
+  using ScopedLockType = juce::GenericScopedLock<CheckedCriticalSection>;
+
+  AMENBREAK_NO_INLINE void enter() const noexcept {
+#if AMENBREAK_REALTIME_GUARD
+    if (RealtimeGuard::isInRealtimeScope()) {
+      RealtimeGuard::recordViolation(RealtimeGuard::Violation::lock,
+                                     AMENBREAK_CALL_SITE());
+      RealtimeGuard::skipNextLockHook();
+    }
+#endif
+    mLock.enter();
+  }
+
+  bool tryEnter() const noexcept { return mLock.tryEnter(); }
+  void exit() const noexcept { mLock.exit(); }
+
+private:
+  juce::CriticalSection mLock;
+};
+
+// juce::SpinLock that reports a blocking enter() from a realtime scope. The
+// audio thread may only tryEnter() it.
+class CheckedSpinLock {
+public:
+  using ScopedLockType = juce::GenericScopedLock<CheckedSpinLock>;
+  using ScopedTryLockType = juce::GenericScopedTryLock<CheckedSpinLock>;
+
+  AMENBREAK_NO_INLINE void enter() const noexcept {
+#if AMENBREAK_REALTIME_GUARD
+    if (RealtimeGuard::isInRealtimeScope())
+      RealtimeGuard::recordViolation(RealtimeGuard::Violation::lock,
+                                     AMENBREAK_CALL_SITE());
+#endif
+    mLock.enter();
+  }
+
+  bool tryEnter() const noexcept { return mLock.tryEnter(); }
+  void exit() const noexcept { mLock.exit(); }
+
+private:
+  juce::SpinLock mLock;
+};
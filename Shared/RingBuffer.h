@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    RingBuffer.h
+    Used by AmenBreakChopper
+
+    Multi-channel circular sample buffer with a power-of-two capacity, so
+    positions wrap with a mask (negative ones included) instead of a modulo.
+    Accessors hand out a range as at most two contiguous spans around the
+    wrap point, ready for juce::FloatVectorOperations. Channels start on
+    cache-line boundaries and are padded by one line so the same position in
+    two channels never maps to the same cache set.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+template <typename SampleType> class RingBuffer {
+public:
+  // A circular range split at the wrap point; second is empty unless the
+  // range wraps.
+  template <typename Pointer> struct Spans {
+    Pointer first;
+    int firstSize;
+    Pointer second;
+    int secondSize;
+  };
+
+  // Allocates and clears; not realtime safe. The capacity is rounded up to a
+  // power of two, and 0 releases the storage.
+  void setSize(int numChannels, int minimumCapacity) {
+    mNumChannels = minimumCapacity > 0 ? numChannels : 0;
+    mCapacity = minimumCapacity > 0 ? juce::nextPowerOfTwo(minimumCapacity) : 0;
+    mMask = juce::jmax(0, mCapacity - 1);
+    mChannelStride = mCapacity + kAlignmentSamples;
+
+    mStorage.free();
+    mData = nullptr;
+    if (mNumChannels == 0)
+      return;
+
+    mStorage.allocate(
+        (size_t)(mNumChannels * mChannelStride + kAlignmentSamples), true);
+    const auto address = reinterpret_cast<juce::pointer_sized_uint>(
+        mStorage.get());
+    mData = reinterpret_cast<SampleType *>(
+        (address + kAlignmentBytes - 1) & ~(juce::pointer_sized_uint)(
+                                               kAlignmentBytes - 1));
+  }
+
+  void clear() {
+    if (mData != nullptr)
+      std::fill(mData, mData + mNumChannels * mChannelStride, SampleType());
+  }
+
+  int getNumChannels() const noexcept { return mNumChannels; }
+  int getCapacity() const noexcept { return mCapacity; }
+  int wrap(int position) const noexcept { return position & mMask; }
+
+  const SampleType *getReadPointer(int channel) const noexcept {
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+    return mData + channel * mChannelStride;
+  }
+
+  SampleType *getWritePointer(int channel) noexcept {
+    jassert(juce::isPositiveAndBelow(channel, mNumChannels));
+    return mData + channel * mChannelStride;
+  }
+
+  // numSamples must not exceed the capacity.
+  Spans<const SampleType *> getReadSpans(int channel, int position,
+                                         int numSamples) const noexcept {
+    return makeSpans(getReadPointer(channel), position, numSamples);
+  }
+
+  Spans<SampleType *> getWriteSpans(int channel, int position,
+                                    int numSamples) noexcept {
+    return makeSpans(getWritePointer(channel), position, numSamples);
+  }
+
+private:
+  static constexpr int kAlignmentBytes = 64;
+  static constexpr int kAlignmentSamples =
+      kAlignmentBytes / (int)sizeof(SampleType);
+
+  template <typename Pointer>
+  Spans<Pointer> makeSpans(Pointer channelData, int position,
+                           int numSamples) const noexcept {
+    jassert(numSamples <= mCapacity);
+    position = wrap(position);
+    const int firstSize = juce::jmin(numSamples, mCapacity - position);
+    return {channelData + position, firstSize, channelData,
+            numSamples - firstSize};
+  }
+
+  juce::HeapBlock<SampleType> mStorage;
+  SampleType *mData{nullptr}; // mStorage, aligned to kAlignmentBytes
+  int mNumChannels{0};
+  int mCapacity{0};
+  int mMask{0};
+  int mChannelStride{0};
+};
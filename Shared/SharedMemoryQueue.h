@@ -0,0 +1,351 @@
+/*
+  ==============================================================================
+
+    SharedMemoryQueue.h
+    Shared by AmenBreakChopper and AmenBreakController
+
+    Single-producer/single-consumer queue in a memory-mapped file, used as
+    an alternative to loopback UDP when the Controller and the Chopper run on
+    the same host. The receiving side creates the file for its OSC receive
+    port and the sending side maps the file for its OSC send port, so the
+    port settings pair the two exactly as they do for OSC. push() and pop()
+    are a copy plus an atomic index update: no encoding, no syscall and no
+    message-thread hop.
+
+    The consumer stamps a heartbeat each time it drains the queue. A
+    producer only trusts a queue whose heartbeat is recent, so a file left
+    behind by a closed plugin makes it fall back to OSC instead of sending
+    into the void.
+
+    The file lives in a per-user directory. On POSIX it is created with
+    mode 0600 and only ever opened without following symlinks, and a file
+    that belongs to another user (or that others can write) is refused.
+
+    Each side also claims the queue with a per-instance token, so two
+    instances set to the same port can't both push or both pop. A claim
+    held by a live peer (recent heartbeat) is refused with inUse and the
+    caller stays on OSC; a stale one is taken over.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstring>
+#include <juce_core/juce_core.h>
+#include <memory>
+#include <type_traits>
+
+#if !JUCE_WINDOWS
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+template <typename ItemType, int Capacity> class SharedMemoryQueue {
+public:
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "Capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<ItemType>::value,
+                "Items are copied byte for byte between processes");
+  static_assert(std::atomic<juce::uint32>::is_always_lock_free &&
+                    std::atomic<juce::int64>::is_always_lock_free,
+                "Atomics in shared memory must not use a process-local lock");
+
+  static constexpr juce::int64 kHeartbeatTimeoutMs = 500;
+
+  enum class OpenResult { opened, failed, inUse };
+
+  SharedMemoryQueue() = default;
+  ~SharedMemoryQueue() { close(); }
+
+  // Per user, so nobody else can plant or read the queue. Not tempDirectory
+  // on macOS: that is per application, and the two plugins may well be
+  // loaded by different ones.
+  static juce::File getFileForPort(int port) {
+#if JUCE_WINDOWS
+    const auto directory =
+        juce::File::getSpecialLocation(juce::File::tempDirectory);
+#elif JUCE_MAC
+    const auto directory =
+        juce::File::getSpecialLocation(juce::File::userHomeDirectory)
+            .getChildFile("Library/Caches/AmenBreak");
+#else
+    const auto directory =
+        juce::File::getSpecialLocation(
+            juce::File::userApplicationDataDirectory)
+            .getChildFile("AmenBreak");
+#endif
+    return directory.getChildFile("AmenBreak-" + juce::String(port) +
+                                  ".queue");
+  }
+
+  // Consumer side, message thread. Maps the file, creating it if needed,
+  // claims it and discards whatever is still queued in it.
+  OpenResult openAsConsumer(const juce::File &file) {
+    close();
+    if (!file.getParentDirectory().createDirectory() || !map(file, true))
+      return OpenResult::failed;
+
+    auto *header = getHeader();
+    const auto now = juce::Time::currentTimeMillis();
+    if (header->magic.load(std::memory_order_acquire) == kMagic &&
+        !isCompatible()) {
+      close();
+      return OpenResult::failed;
+    }
+    if (!claim(header->consumerToken, header->heartbeatMs, now)) {
+      close();
+      return OpenResult::inUse;
+    }
+    mIsConsumer = true;
+
+    if (header->magic.load(std::memory_order_acquire) != kMagic) {
+      header->itemSize = (juce::uint32)sizeof(ItemType);
+      header->capacity = (juce::uint32)Capacity;
+      header->writeIndex.store(0, std::memory_order_relaxed);
+      header->readIndex.store(0, std::memory_order_relaxed);
+      header->magic.store(kMagic, std::memory_order_release);
+    }
+
+    header->readIndex.store(header->writeIndex.load(std::memory_order_acquire),
+                            std::memory_order_release);
+    return OpenResult::opened;
+  }
+
+  // Producer side. Fails unless a consumer has created the file.
+  OpenResult openAsProducer(const juce::File &file) {
+    close();
+    if (!map(file, false))
+      return OpenResult::failed;
+
+    auto *header = getHeader();
+    if (header->magic.load(std::memory_order_acquire) != kMagic ||
+        !isCompatible()) {
+      close();
+      return OpenResult::failed;
+    }
+    if (!claim(header->producerToken, header->producerHeartbeatMs,
+               juce::Time::currentTimeMillis())) {
+      close();
+      return OpenResult::inUse;
+    }
+    mIsProducer = true;
+    return OpenResult::opened;
+  }
+
+  // Releases this side's claim. A closing consumer also clears its
+  // heartbeat so producers fall back at once.
+  void close() {
+    if (mData != nullptr) {
+      auto *header = getHeader();
+      if (mIsConsumer && release(header->consumerToken))
+        header->heartbeatMs.store(0, std::memory_order_release);
+      if (mIsProducer && release(header->producerToken))
+        header->producerHeartbeatMs.store(0, std::memory_order_release);
+    }
+    mIsConsumer = false;
+    mIsProducer = false;
+    unmap();
+  }
+
+  bool isOpen() const noexcept { return mData != nullptr; }
+
+  // Producer side. Returns false (and drops the item) when the queue is full.
+  bool push(const ItemType &item) noexcept {
+    auto *header = getHeader();
+    const auto write = header->writeIndex.load(std::memory_order_relaxed);
+    if (write - header->readIndex.load(std::memory_order_acquire) >=
+        (juce::uint32)Capacity)
+      return false;
+
+    std::memcpy(getItems() + (write & kMask), &item, sizeof(ItemType));
+    header->writeIndex.store(write + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false when there is nothing to read.
+  bool pop(ItemType &item) noexcept {
+    auto *header = getHeader();
+    const auto read = header->readIndex.load(std::memory_order_relaxed);
+    if (read == header->writeIndex.load(std::memory_order_acquire))
+      return false;
+
+    std::memcpy(&item, getItems() + (read & kMask), sizeof(ItemType));
+    header->readIndex.store(read + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, whenever it drains the queue. Returns false, and leaves
+  // the heartbeat alone, once another consumer has taken the queue over.
+  bool setHeartbeat(juce::int64 nowMs) noexcept {
+    auto *header = getHeader();
+    if (header->consumerToken.load(std::memory_order_acquire) != mToken)
+      return false;
+    header->heartbeatMs.store(nowMs, std::memory_order_release);
+    return true;
+  }
+
+  // Producer side, periodically. Returns false once another producer has
+  // taken the queue over.
+  bool setProducerHeartbeat(juce::int64 nowMs) noexcept {
+    if (!isProducerOwner())
+      return false;
+    getHeader()->producerHeartbeatMs.store(nowMs, std::memory_order_release);
+    return true;
+  }
+
+  bool isProducerOwner() const noexcept {
+    return getHeader()->producerToken.load(std::memory_order_acquire) ==
+           mToken;
+  }
+
+  // Producer side.
+  bool isConsumerAlive(juce::int64 nowMs) const noexcept {
+    const auto heartbeat =
+        getHeader()->heartbeatMs.load(std::memory_order_acquire);
+    return heartbeat > 0 && nowMs - heartbeat < kHeartbeatTimeoutMs;
+  }
+
+private:
+  struct Header {
+    std::atomic<juce::uint32> magic; // Written last by the creating consumer
+    juce::uint32 itemSize;
+    juce::uint32 capacity;
+    alignas(64) std::atomic<juce::uint32> writeIndex;
+    alignas(64) std::atomic<juce::uint32> readIndex;
+    std::atomic<juce::int64> heartbeatMs;
+    std::atomic<juce::uint64> consumerToken; // 0 while unclaimed
+    std::atomic<juce::uint64> producerToken;
+    std::atomic<juce::int64> producerHeartbeatMs;
+  };
+
+  static constexpr juce::uint32 kMagic = 0x41424d51; // "ABMQ"
+  static constexpr juce::uint32 kMask = (juce::uint32)Capacity - 1;
+  static constexpr size_t kFileSize =
+      sizeof(Header) + sizeof(ItemType) * (size_t)Capacity;
+
+  // The consumer creates the file, or resizes one of the wrong size. An
+  // existing file of the right size is reused as is: truncating it would
+  // crash a producer that still has it mapped.
+#if JUCE_WINDOWS
+  bool map(const juce::File &file, bool create) {
+    if (create && file.getSize() != (juce::int64)kFileSize) {
+      juce::FileOutputStream stream(file);
+      if (stream.failedToOpen() || !stream.setPosition(0) ||
+          stream.truncate().failed() ||
+          !stream.writeRepeatedByte(0, kFileSize))
+        return false;
+    }
+    if (file.getSize() != (juce::int64)kFileSize)
+      return false;
+
+    mFile = std::make_unique<juce::MemoryMappedFile>(
+        file, juce::MemoryMappedFile::readWrite, false);
+    if (mFile->getData() == nullptr || mFile->getSize() < kFileSize) {
+      mFile.reset();
+      return false;
+    }
+    mData = mFile->getData();
+    return true;
+  }
+
+  void unmap() {
+    mFile.reset();
+    mData = nullptr;
+  }
+#else
+  // Works on one descriptor from open() to mmap(), so the checked file is
+  // the mapped one.
+  bool map(const juce::File &file, bool create) {
+    const auto path = file.getFullPathName();
+    int fd = ::open(path.toRawUTF8(), O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0 && errno == ENOENT && create) {
+      fd = ::open(path.toRawUTF8(),
+                  O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+      if (fd < 0 && errno == EEXIST) // Another consumer created it first
+        fd = ::open(path.toRawUTF8(), O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+    }
+    if (fd < 0)
+      return false;
+
+    struct stat info;
+    bool usable = ::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) &&
+                  info.st_uid == ::geteuid() &&
+                  (info.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+    if (usable && info.st_size != (off_t)kFileSize)
+      usable = create && ::ftruncate(fd, 0) == 0 &&
+               ::ftruncate(fd, (off_t)kFileSize) == 0;
+
+    void *data = usable ? ::mmap(nullptr, kFileSize, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED, fd, 0)
+                        : MAP_FAILED;
+    ::close(fd);
+    if (data == MAP_FAILED)
+      return false;
+    mData = data;
+    return true;
+  }
+
+  void unmap() {
+    if (mData != nullptr)
+      ::munmap(mData, kFileSize);
+    mData = nullptr;
+  }
+#endif
+
+  // Takes the claim when it is free, already ours or left by a peer whose
+  // heartbeat went stale. Two claimants racing for a stale claim can both
+  // win the exchange, so the claim is checked again after stamping the
+  // heartbeat: the one that was overtaken backs off.
+  bool claim(std::atomic<juce::uint64> &token,
+             std::atomic<juce::int64> &heartbeat, juce::int64 nowMs) {
+    auto owner = token.load(std::memory_order_acquire);
+    if (owner != 0 && owner != mToken &&
+        nowMs - heartbeat.load(std::memory_order_acquire) <
+            kHeartbeatTimeoutMs)
+      return false;
+    if (owner != mToken &&
+        !token.compare_exchange_strong(owner, mToken,
+                                       std::memory_order_acq_rel))
+      return false;
+    heartbeat.store(nowMs, std::memory_order_release);
+    return token.load(std::memory_order_acquire) == mToken;
+  }
+
+  bool release(std::atomic<juce::uint64> &token) {
+    auto owner = mToken;
+    return token.compare_exchange_strong(owner, 0, std::memory_order_acq_rel);
+  }
+
+  static juce::uint64 makeToken() {
+    return (juce::uint64)juce::Random().nextInt64() | 1;
+  }
+
+  bool isCompatible() const {
+    const auto *header = getHeader();
+    return header->itemSize == sizeof(ItemType) &&
+           header->capacity == (juce::uint32)Capacity;
+  }
+
+  Header *getHeader() const noexcept {
+    return static_cast<Header *>(mData);
+  }
+
+  ItemType *getItems() const noexcept {
+    return reinterpret_cast<ItemType *>(getHeader() + 1);
+  }
+
+#if JUCE_WINDOWS
+  std::unique_ptr<juce::MemoryMappedFile> mFile;
+#endif
+  void *mData{nullptr};
+  const juce::uint64 mToken{makeToken()}; // Per instance, never 0
+  bool mIsConsumer{false};
+  bool mIsProducer{false};
+
+  JUCE_DECLARE_NON_COPYABLE(SharedMemoryQueue)
+};
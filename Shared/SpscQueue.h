@@ -0,0 +1,56 @@
+/*
+  ==============================================================================
+
+    SpscQueue.h
+    Shared by AmenBreakChopper and AmenBreakController
+
+    Fixed-capacity single-producer/single-consumer queue on top of
+    juce::AbstractFifo. Storage is allocated once with the queue, so push()
+    and pop() never allocate or lock and can be used on the audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <juce_core/juce_core.h>
+
+template <typename ItemType, int Capacity> class SpscQueue {
+public:
+  // AbstractFifo keeps one slot free to tell "full" from "empty".
+  static constexpr int maxItems = Capacity - 1;
+
+  // Producer side. Returns false (and drops the item) when the queue is full.
+  bool push(const ItemType &item) {
+    int start1, size1, start2, size2;
+    mFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 == 0)
+      return false;
+
+    mItems[(size_t)(size1 > 0 ? start1 : start2)] = item;
+    mFifo.finishedWrite(1);
+    return true;
+  }
+
+  // Consumer side. Returns false when there is nothing to read.
+  bool pop(ItemType &item) {
+    int start1, size1, start2, size2;
+    mFifo.prepareToRead(1, start1, size1, start2, size2);
+    if (size1 + size2 == 0)
+      return false;
+
+    item = mItems[(size_t)(size1 > 0 ? start1 : start2)];
+    mFifo.finishedRead(1);
+    return true;
+  }
+
+  int getNumReady() const { return mFifo.getNumReady(); }
+
+  // Only call while neither side is running.
+  void reset() { mFifo.reset(); }
+
+private:
+  juce::AbstractFifo mFifo{Capacity};
+  std::array<ItemType, (size_t)Capacity> mItems{};
+};
@@ -27,13 +27,24 @@ export function WaveformDisplay({ activeSlices, isPlaying, colorTheme, originalP
   useEffect(() => {
     const handleWaveformUpdate = (event: any) => {
       // console.log("[Waveform] Update Received", event);
-      // Expecting { data: [ 512 floats ] }
-      if (event && event.data && Array.isArray(event.data) && event.data.length === 512) {
-        // Chunk into 16 slices of 32
-        const raw = event.data as number[];
+      // Expecting { frame: base64 of 16 x 32 int8 (min, max) pairs }
+      if (event && typeof event.frame === 'string') {
+        const bytes = Uint8Array.from(atob(event.frame), c => c.charCodeAt(0));
+        if (bytes.length !== 16 * 32 * 2) {
+          console.warn("[Waveform] Invalid frame size received", bytes.length);
+          return;
+        }
+        // Draw each bin with whichever extreme has the larger magnitude
+        const pairs = new Int8Array(bytes.buffer);
         const newWaveforms: number[][] = [];
         for (let i = 0; i < 16; i++) {
-            newWaveforms.push(raw.slice(i * 32, (i + 1) * 32));
+            const slice = new Array<number>(32);
+            for (let j = 0; j < 32; j++) {
+                const min = pairs[(i * 32 + j) * 2];
+                const max = pairs[(i * 32 + j) * 2 + 1];
+                slice[j] = (Math.abs(max) >= Math.abs(min) ? max : min) / 127;
+            }
+            newWaveforms.push(slice);
         }
         setWaveforms(newWaveforms);
       } else {